@@ -287,6 +287,17 @@ int get_clipped_rects( const dib_info *dib, const RECT *rc, HRGN clip, struct cl
     for (i = region_find_pt( region, rect.left, rect.top, NULL ); i < region->numRects; i++)
     {
         if (region->rects[i].top >= rect.bottom) break;
+        /* skip the rest of the band, or the start of the band, without visiting each rect */
+        if (region->rects[i].left >= rect.right)
+        {
+            i = region_skip_band( region, i, INT_MAX ) - 1;
+            continue;
+        }
+        if (region->rects[i].right <= rect.left)
+        {
+            i = region_skip_band( region, i, rect.left ) - 1;
+            continue;
+        }
         if (!intersect_rect( out, &rect, &region->rects[i] )) continue;
         out++;
         if (out == &clip_rects->buffer[ARRAY_SIZE( clip_rects->buffer )])
@@ -45,6 +45,19 @@ enum glyph_type
 
 #define GLYPH_CACHE_PAGE_SIZE  0x100
 #define GLYPH_CACHE_PAGES      (0x10000 / GLYPH_CACHE_PAGE_SIZE)
+#define GLYPH_BLOCK_MIN_SIZE   0x1000
+#define GLYPH_BLOCK_MAX_SIZE   0x10000
+
+/* glyph bitmaps are sub-allocated from blocks owned by the font, and freed with it;
+ * blocks start small and double in size for each new block, so that fonts with few
+ * glyphs cached don't waste much memory */
+struct glyph_block
+{
+    struct glyph_block   *next;
+    SIZE_T                used;
+    SIZE_T                size;
+    BYTE                  data[1];
+};
 
 struct cached_font
 {
@@ -55,6 +68,8 @@ struct cached_font
     XFORM                 xform;
     UINT                  aa_flags;
     struct cached_glyph **glyphs[GLYPH_NBTYPES][GLYPH_CACHE_PAGES];
+    struct glyph_block   *blocks;
+    SIZE_T                block_size;
 };
 
 static struct list font_cache = LIST_INIT( font_cache );
@@ -560,7 +575,7 @@ static int font_cache_cmp( const struct cached_font *p1, const struct cached_fon
 static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 {
     struct cached_font font, *ptr, *last_unused = NULL;
-    UINT i = 0, j, k;
+    UINT i = 0, j;
 
     NtGdiExtGetObjectW( hfont, sizeof(font.lf), &font.lf );
     font.xform = dc->xformWorld2Vport;
@@ -593,16 +608,16 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
 
     if (i > 5)  /* keep at least 5 of the most-recently used fonts around */
     {
+        struct glyph_block *block, *next;
+
         ptr = last_unused;
         for (i = 0; i < GLYPH_NBTYPES; i++)
-        {
             for (j = 0; j < GLYPH_CACHE_PAGES; j++)
-            {
-                if (!ptr->glyphs[i][j]) continue;
-                for (k = 0; k < GLYPH_CACHE_PAGE_SIZE; k++)
-                    HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j][k] );
                 HeapFree( GetProcessHeap(), 0, ptr->glyphs[i][j] );
-            }
+        for (block = ptr->blocks; block; block = next)
+        {
+            next = block->next;
+            HeapFree( GetProcessHeap(), 0, block );
         }
         list_remove( &ptr->entry );
     }
@@ -615,6 +630,8 @@ static struct cached_font *add_cached_font( DC *dc, HFONT hfont, UINT aa_flags )
     *ptr = font;
     ptr->ref = 1;
     memset( ptr->glyphs, 0, sizeof(ptr->glyphs) );
+    ptr->blocks = NULL;
+    ptr->block_size = GLYPH_BLOCK_MIN_SIZE;
 done:
     list_add_head( &font_cache, &ptr->entry );
     LeaveCriticalSection( &font_cache_cs );
@@ -627,8 +644,72 @@ void release_cached_font( struct cached_font *font )
     if (font) InterlockedDecrement( &font->ref );
 }
 
+/* allocate space for a glyph bitmap from the font's glyph blocks */
+static struct cached_glyph *alloc_cached_glyph( struct cached_font *font, SIZE_T size )
+{
+    struct glyph_block *block;
+    void *ret = NULL;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    EnterCriticalSection( &font_cache_cs );
+    if ((block = font->blocks) && block->size - block->used >= size)
+    {
+        ret = block->data + block->used;
+        block->used += size;
+    }
+    else
+    {
+        SIZE_T block_size = max( size, font->block_size );
+
+        if ((block = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct glyph_block, data[block_size] ))))
+        {
+            block->used = size;
+            block->size = block_size;
+            if (font->block_size < GLYPH_BLOCK_MAX_SIZE) font->block_size *= 2;
+            /* keep filling the current block if the new one has no room left */
+            if (font->blocks && block->size - block->used < font->blocks->size - font->blocks->used)
+            {
+                block->next = font->blocks->next;
+                font->blocks->next = block;
+            }
+            else
+            {
+                block->next = font->blocks;
+                font->blocks = block;
+            }
+            ret = block->data;
+        }
+    }
+    LeaveCriticalSection( &font_cache_cs );
+    return ret;
+}
+
+/* give back the space of a glyph that didn't get cached, if it's still the last one of its block */
+static void free_cached_glyph( struct cached_font *font, struct cached_glyph *glyph, SIZE_T size )
+{
+    struct glyph_block *block, **prev;
+
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+    EnterCriticalSection( &font_cache_cs );
+    for (prev = &font->blocks; (block = *prev); prev = &block->next)
+    {
+        if ((BYTE *)glyph + size != block->data + block->used) continue;
+        block->used -= size;
+        /* only the first block is allocated from, release other empty ones */
+        if (!block->used && prev != &font->blocks)
+        {
+            *prev = block->next;
+            HeapFree( GetProcessHeap(), 0, block );
+        }
+        break;
+    }
+    LeaveCriticalSection( &font_cache_cs );
+}
+
 static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT index, UINT flags,
-                                              struct cached_glyph *glyph )
+                                              struct cached_glyph *glyph, SIZE_T size )
 {
     struct cached_glyph *ret;
     enum glyph_type type = (flags & ETO_GLYPH_INDEX) ? GLYPH_INDEX : GLYPH_WCHAR;
@@ -642,7 +723,7 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
         ptr = HeapAlloc( GetProcessHeap(), HEAP_ZERO_MEMORY, GLYPH_CACHE_PAGE_SIZE * sizeof(*ptr) );
         if (!ptr)
         {
-            HeapFree( GetProcessHeap(), 0, glyph );
+            free_cached_glyph( font, glyph, size );
             return NULL;
         }
         if (InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page], ptr, NULL ))
@@ -650,7 +731,7 @@ static struct cached_glyph *add_cached_glyph( struct cached_font *font, UINT ind
     }
     ret = InterlockedCompareExchangePointer( (void **)&font->glyphs[type][page][entry], glyph, NULL );
     if (!ret) ret = glyph;
-    else HeapFree( GetProcessHeap(), 0, glyph );
+    else free_cached_glyph( font, glyph, size );
     return ret;
 }
 
@@ -759,6 +840,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     int pad = 0, stride, bit_count;
     GLYPHMETRICS metrics;
     struct cached_glyph *glyph;
+    SIZE_T alloc_size;
 
     if (flags & ETO_GLYPH_INDEX) ggo_flags |= GGO_GLYPH_INDEX;
     indices[0] = index;
@@ -775,7 +857,8 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
     bit_count = get_glyph_depth( font->aa_flags );
     stride = get_dib_stride( metrics.gmBlackBoxX, bit_count );
     size = metrics.gmBlackBoxY * stride;
-    glyph = HeapAlloc( GetProcessHeap(), 0, FIELD_OFFSET( struct cached_glyph, bits[size] ));
+    alloc_size = FIELD_OFFSET( struct cached_glyph, bits[size] );
+    glyph = alloc_cached_glyph( font, alloc_size );
     if (!glyph) return NULL;
     if (!size) goto done;  /* empty glyph */
 
@@ -785,7 +868,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
                                 &identity, FALSE );
     if (ret == GDI_ERROR)
     {
-        HeapFree( GetProcessHeap(), 0, glyph );
+        free_cached_glyph( font, glyph, alloc_size );
         return NULL;
     }
     assert( ret <= size );
@@ -810,7 +893,7 @@ static struct cached_glyph *cache_glyph_bitmap( DC *dc, struct cached_font *font
 
 done:
     glyph->metrics = metrics;
-    return add_cached_glyph( font, index, flags, glyph );
+    return add_cached_glyph( font, index, flags, glyph, alloc_size );
 }
 
 static void render_string( DC *dc, dib_info *dib, struct cached_font *font, INT x, INT y,
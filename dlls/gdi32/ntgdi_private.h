@@ -473,6 +473,35 @@ static inline int region_find_pt( const WINEREGION *rgn, int x, int y, BOOL *hit
     return h ? i : start;
 }
 
+/**********************************************************
+ *     region_skip_band
+ *
+ * Return the index of the first rectangle after i that either ends after x
+ * or belongs to a following band. Rectangle i must end at or before x.
+ * Pass INT_MAX as x to skip to the next band.
+ */
+static inline int region_skip_band( const WINEREGION *rgn, int i, int x )
+{
+    int top = rgn->rects[i].top, lo = i + 1, hi = i + 1, step = 1, mid;
+
+    /* gallop first, bands usually hold only a few rectangles */
+    while (hi < rgn->numRects && rgn->rects[hi].top == top && rgn->rects[hi].right <= x)
+    {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > rgn->numRects) hi = rgn->numRects;
+
+    while (lo < hi)
+    {
+        mid = (lo + hi) / 2;
+        if (rgn->rects[mid].top == top && rgn->rects[mid].right <= x) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
 /* null driver entry points */
 extern BOOL CDECL nulldrv_AbortPath( PHYSDEV dev ) DECLSPEC_HIDDEN;
 extern BOOL CDECL nulldrv_AlphaBlend( PHYSDEV dst_dev, struct bitblt_coords *dst,
@@ -1024,10 +1024,18 @@ BOOL WINAPI NtGdiRectInRegion( HRGN hrgn, const RECT *rect )
 		    break;                /* too far down */
 
 		if (obj->rects[i].right <= rc.left)
-		    continue;              /* not far enough over yet */
+		{
+		    /* not far enough over yet, skip to the first candidate in the band */
+		    i = region_skip_band( obj, i, rc.left ) - 1;
+		    continue;
+		}
 
 		if (obj->rects[i].left >= rc.right)
+		{
+		    /* too far over, skip to the next band */
+		    i = region_skip_band( obj, i, INT_MAX ) - 1;
 		    continue;
+		}
 
 		ret = TRUE;
 	    }
@@ -42,6 +42,7 @@
 static LPVOID (WINAPI *pHeapAlloc)(HANDLE,DWORD,SIZE_T);
 static LPVOID (WINAPI *pHeapReAlloc)(HANDLE,DWORD,LPVOID,SIZE_T);
 static BOOL (WINAPI *pHeapQueryInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T, PSIZE_T);
+static BOOL (WINAPI *pHeapSetInformation)(HANDLE, HEAP_INFORMATION_CLASS, PVOID, SIZE_T);
 static BOOL (WINAPI *pGetPhysicallyInstalledSystemMemory)(ULONGLONG *);
 static ULONG (WINAPI *pRtlGetNtGlobalFlags)(void);
 
@@ -889,6 +890,73 @@ static void test_HeapQueryInformation(void)
     ok(info == 0 || info == 1 || info == 2, "expected 0, 1 or 2, got %u\n", info);
 }
 
+static void test_HeapSetInformation(void)
+{
+    void *ptrs[1000];
+    ULONG info;
+    HANDLE heap;
+    SIZE_T size;
+    BOOL ret;
+    int i;
+
+    pHeapSetInformation = (void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "HeapSetInformation");
+    if (!pHeapSetInformation || !pHeapQueryInformation)
+    {
+        win_skip("HeapSetInformation is not available\n");
+        return;
+    }
+
+    heap = HeapCreate(HEAP_NO_SERIALIZE, 0, 0);
+    ok(heap != NULL, "HeapCreate failed\n");
+    info = 2;
+    ret = pHeapSetInformation(heap, HeapCompatibilityInformation, &info, sizeof(info));
+    ok(!ret, "HeapSetInformation should fail on a HEAP_NO_SERIALIZE heap\n");
+    HeapDestroy(heap);
+
+    heap = HeapCreate(0, 0, 0);
+    ok(heap != NULL, "HeapCreate failed\n");
+    info = 2;
+    ret = pHeapSetInformation(heap, HeapCompatibilityInformation, &info, sizeof(info));
+    if (!ret && (IsDebuggerPresent() || (pRtlGetNtGlobalFlags &&
+                 (pRtlGetNtGlobalFlags() & (FLG_HEAP_ENABLE_TAIL_CHECK | FLG_HEAP_ENABLE_FREE_CHECK |
+                                            FLG_HEAP_VALIDATE_PARAMETERS | FLG_HEAP_VALIDATE_ALL |
+                                            FLG_HEAP_PAGE_ALLOCS)))))
+    {
+        skip("low-fragmentation heap is disabled with heap debugging\n");
+        HeapDestroy(heap);
+        return;
+    }
+    ok(ret, "HeapSetInformation error %u\n", GetLastError());
+
+    info = 0xdeadbeef;
+    ret = pHeapQueryInformation(heap, HeapCompatibilityInformation, &info, sizeof(info), NULL);
+    ok(ret, "HeapQueryInformation error %u\n", GetLastError());
+    ok(info == 2, "expected 2, got %u\n", info);
+
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++)
+    {
+        ptrs[i] = HeapAlloc(heap, HEAP_ZERO_MEMORY, i % 300 + 1);
+        ok(ptrs[i] != NULL, "HeapAlloc failed\n");
+        ok(!((BYTE *)ptrs[i])[i % 300], "memory not zeroed\n");
+        size = HeapSize(heap, 0, ptrs[i]);
+        ok(size == i % 300 + 1, "got size %lu\n", size);
+        memset(ptrs[i], 0xcc, i % 300 + 1);
+    }
+    for (i = 0; i < ARRAY_SIZE(ptrs); i += 2) HeapFree(heap, 0, ptrs[i]);
+    for (i = 0; i < ARRAY_SIZE(ptrs); i += 2)
+    {
+        ptrs[i] = HeapAlloc(heap, 0, 2 * (i % 300) + 1);
+        ok(ptrs[i] != NULL, "HeapAlloc failed\n");
+        size = HeapSize(heap, 0, ptrs[i]);
+        ok(size == 2 * (i % 300) + 1, "got size %lu\n", size);
+    }
+    ret = HeapValidate(heap, 0, NULL);
+    ok(ret, "HeapValidate failed\n");
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++) HeapFree(heap, 0, ptrs[i]);
+
+    HeapDestroy(heap);
+}
+
 static void test_heap_checks( DWORD flags )
 {
     BYTE old, *p, *p2;
@@ -1296,6 +1364,7 @@ START_TEST(heap)
     test_sized_HeapReAlloc((1 << 20), 1);
 
     test_HeapQueryInformation();
+    test_HeapSetInformation();
     test_GetPhysicallyInstalledSystemMemory();
     test_GlobalMemoryStatus();
 
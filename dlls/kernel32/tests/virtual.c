@@ -51,6 +51,8 @@ static BOOL   (WINAPI *pGetProcessDEPPolicy)(HANDLE, LPDWORD, PBOOL);
 static BOOL   (WINAPI *pIsWow64Process)(HANDLE, PBOOL);
 static NTSTATUS (WINAPI *pNtProtectVirtualMemory)(HANDLE, PVOID *, SIZE_T *, ULONG, ULONG *);
 static PVOID (WINAPI *pVirtualAllocFromApp)(PVOID, SIZE_T, DWORD, DWORD);
+static BOOL (WINAPI *pK32QueryWorkingSetEx)(HANDLE, PVOID, DWORD);
+static SIZE_T (WINAPI *pGetLargePageMinimum)(void);
 
 /* ############################### */
 
@@ -477,6 +479,88 @@ static void test_VirtualAllocFromApp(void)
             p, GetLastError());
 }
 
+static void test_large_pages(void)
+{
+    MEMORY_WORKING_SET_EX_INFORMATION info;
+    SIZE_T large_page_size;
+    char *addr, *base;
+    BOOL ret;
+
+    if (!pGetLargePageMinimum)
+    {
+        win_skip("GetLargePageMinimum not found\n");
+        return;
+    }
+    large_page_size = pGetLargePageMinimum();
+    if (!large_page_size)
+    {
+        skip("large pages are not supported\n");
+        return;
+    }
+    ok(!(large_page_size & (si.dwPageSize - 1)), "got large page size %#lx\n", large_page_size);
+
+    /* find a range to use for the misaligned base */
+    base = VirtualAlloc(NULL, 2 * large_page_size, MEM_RESERVE, PAGE_NOACCESS);
+    ok(base != NULL, "VirtualAlloc failed %u\n", GetLastError());
+    ret = VirtualFree(base, 0, MEM_RELEASE);
+    ok(ret, "VirtualFree failed %u\n", GetLastError());
+    base = (char *)(((UINT_PTR)base + large_page_size - 1) & ~(large_page_size - 1));
+
+    /* large pages must be reserved and committed at once */
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size, MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER || broken(GetLastError() == ERROR_PRIVILEGE_NOT_HELD),
+       "got error %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size, MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER || broken(GetLastError() == ERROR_PRIVILEGE_NOT_HELD),
+       "got error %u\n", GetLastError());
+
+    /* the base and size must be large page aligned */
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size + si.dwPageSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                        PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER || broken(GetLastError() == ERROR_PRIVILEGE_NOT_HELD),
+       "got error %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(base + si.dwAllocationGranularity, large_page_size,
+                        MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    ok(!addr, "VirtualAlloc succeeded\n");
+    ok(GetLastError() == ERROR_INVALID_PARAMETER || broken(GetLastError() == ERROR_PRIVILEGE_NOT_HELD),
+       "got error %u\n", GetLastError());
+
+    SetLastError(0xdeadbeef);
+    addr = VirtualAlloc(NULL, large_page_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+    if (!addr && GetLastError() == ERROR_PRIVILEGE_NOT_HELD)
+    {
+        skip("no privilege to use large pages\n");
+        return;
+    }
+    ok(addr != NULL, "VirtualAlloc failed %u\n", GetLastError());
+    ok(!((UINT_PTR)addr & (large_page_size - 1)), "got misaligned address %p\n", addr);
+    addr[0] = 1;
+    addr[large_page_size - 1] = 1;
+
+    if (pK32QueryWorkingSetEx)
+    {
+        memset(&info, 0, sizeof(info));
+        info.VirtualAddress = addr;
+        ret = pK32QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info));
+        ok(ret, "QueryWorkingSetEx failed %u\n", GetLastError());
+        ok(info.VirtualAttributes.Valid, "page is not valid\n");
+        ok(info.VirtualAttributes.LargePage, "page is not a large page\n");
+    }
+    else win_skip("K32QueryWorkingSetEx not found\n");
+
+    ret = VirtualFree(addr, 0, MEM_RELEASE);
+    ok(ret, "VirtualFree failed %u\n", GetLastError());
+}
+
 static void test_MapViewOfFile(void)
 {
     static const char testfile[] = "testfile.xxx";
@@ -4295,6 +4379,8 @@ START_TEST(virtual)
     pRtlRemoveVectoredExceptionHandler = (void *)GetProcAddress( hntdll, "RtlRemoveVectoredExceptionHandler" );
     pNtProtectVirtualMemory = (void *)GetProcAddress( hntdll, "NtProtectVirtualMemory" );
     pVirtualAllocFromApp = (void *)GetProcAddress( hkernelbase, "VirtualAllocFromApp" );
+    pK32QueryWorkingSetEx = (void *)GetProcAddress( hkernel32, "K32QueryWorkingSetEx" );
+    pGetLargePageMinimum = (void *)GetProcAddress( hkernel32, "GetLargePageMinimum" );
 
     GetSystemInfo(&si);
     trace("system page size %#x\n", si.dwPageSize);
@@ -4310,6 +4396,7 @@ START_TEST(virtual)
     test_VirtualAllocEx();
     test_VirtualAlloc();
     test_VirtualAllocFromApp();
+    test_large_pages();
     test_MapViewOfFile();
     test_NtAreMappedFilesTheSame();
     test_CreateFileMapping();
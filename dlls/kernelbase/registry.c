@@ -1540,7 +1540,19 @@ LSTATUS WINAPI DECLSPEC_HOTPATCH RegQueryValueExW( HKEY hkey, LPCWSTR name, LPDW
 
     RtlInitUnicodeString( &name_str, name );
 
-    if (data) total_size = min( sizeof(buffer), *count + info_size );
+    if (data)
+    {
+        total_size = min( sizeof(buffer), *count + info_size );
+        /* if the caller buffer doesn't fit on the stack, allocate one up front
+         * instead of finding out with an extra server call */
+        if (*count + info_size > sizeof(buffer) && *count <= 0x10000 &&
+            (buf_ptr = heap_alloc( *count + info_size )))
+        {
+            info = (KEY_VALUE_PARTIAL_INFORMATION *)buf_ptr;
+            total_size = *count + info_size;
+        }
+        else buf_ptr = buffer;
+    }
     else
     {
         total_size = info_size;
@@ -1548,7 +1560,7 @@ LSTATUS WINAPI DECLSPEC_HOTPATCH RegQueryValueExW( HKEY hkey, LPCWSTR name, LPDW
     }
 
     status = NtQueryValueKey( hkey, &name_str, KeyValuePartialInformation,
-                              buffer, total_size, &total_size );
+                              buf_ptr, total_size, &total_size );
     if (status && status != STATUS_BUFFER_OVERFLOW) goto done;
 
     if (data)
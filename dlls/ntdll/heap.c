@@ -76,6 +76,7 @@ typedef struct
 /* Value for arena 'magic' field */
 #define ARENA_INUSE_MAGIC      0x455355
 #define ARENA_PENDING_MAGIC    0xbedead
+#define ARENA_LFH_MAGIC        0x48464c
 #define ARENA_FREE_MAGIC       0x45455246
 #define ARENA_LARGE_MAGIC      0x6752614c
 
@@ -119,6 +120,12 @@ static const SIZE_T HEAP_freeListSizes[] =
 };
 #define HEAP_NB_FREE_LISTS (ARRAY_SIZE( HEAP_freeListSizes ) + HEAP_NB_SMALL_FREE_LISTS)
 
+/* Max user size of the blocks cached by the low-fragmentation front end */
+#define HEAP_LFH_MAX_SIZE     0x400
+#define HEAP_LFH_NB_BUCKETS   ((ROUND_SIZE(HEAP_LFH_MAX_SIZE) - HEAP_MIN_DATA_SIZE) / ALIGNMENT + 1)
+#define HEAP_LFH_MAX_DEPTH    128  /* max number of blocks cached in a front end bucket */
+#define HEAP_LFH_BATCH        16   /* number of blocks moved at once between front end and backend */
+
 typedef union
 {
     ARENA_FREE  arena;
@@ -137,6 +144,7 @@ typedef struct tagSUBHEAP
     struct tagHEAP     *heap;       /* Main heap structure */
     DWORD               headerSize; /* Size of the heap header */
     DWORD               magic;      /* Magic number */
+    struct tagSUBHEAP  *lfh_next;   /* Next sub-heap in the front end list */
 } SUBHEAP;
 
 #define SUBHEAP_MAGIC    ((DWORD)('S' | ('U'<<8) | ('B'<<16) | ('H'<<24)))
@@ -163,6 +171,9 @@ typedef struct tagHEAP
     ARENA_INUSE    **pending_free;  /* Ring buffer for pending free requests */
     RTL_CRITICAL_SECTION critSection; /* Critical section for serialization */
     FREE_LIST_ENTRY *freeList;      /* Free lists */
+    SLIST_HEADER    *lfh;           /* Low-fragmentation front end buckets, if enabled */
+    SUBHEAP         *lfh_subheaps;  /* Sub-heaps the front end can check without locking */
+    HEAP_WINE_STATISTICS stats;     /* Usage statistics, updated while holding the lock */
 } HEAP;
 
 #define HEAP_MAGIC       ((DWORD)('H' | ('E'<<8) | ('A'<<16) | ('P'<<24)))
@@ -177,10 +188,45 @@ typedef struct tagHEAP
 #define HEAP_VALIDATE_ALL     0x20000000
 #define HEAP_VALIDATE_PARAMS  0x40000000
 
+/* values for HeapCompatibilityInformation */
+#define HEAP_STD  0  /* standard heap */
+#define HEAP_LAL  1  /* look-aside lists */
+#define HEAP_LFH  2  /* low-fragmentation heap */
+
 static HEAP *processHeap;  /* main process heap */
 
 static BOOL HEAP_IsRealArena( HEAP *heapPtr, DWORD flags, LPCVOID block, BOOL quiet );
 
+/* lock the heap, keeping track of the time spent waiting for other threads */
+static inline void heap_lock( HEAP *heap, ULONG flags )
+{
+    LARGE_INTEGER start, end;
+
+    if (flags & HEAP_NO_SERIALIZE) return;
+    if (RtlTryEnterCriticalSection( &heap->critSection )) return;
+
+    NtQueryPerformanceCounter( &start, NULL );
+    RtlEnterCriticalSection( &heap->critSection );
+    NtQueryPerformanceCounter( &end, NULL );
+    heap->stats.ContentionCount++;
+    heap->stats.ContentionTime += end.QuadPart - start.QuadPart;
+}
+
+static inline void heap_unlock( HEAP *heap, ULONG flags )
+{
+    if (flags & HEAP_NO_SERIALIZE) return;
+    RtlLeaveCriticalSection( &heap->critSection );
+}
+
+/* get the statistics size class of an allocation */
+static inline unsigned int get_stats_class( SIZE_T size )
+{
+    unsigned int i;
+
+    for (i = 0; i < HEAP_STATS_NB_CLASSES - 1; i++) if (size <= (SIZE_T)16 << i) break;
+    return i;
+}
+
 /* mark a block of memory as free for debugging purposes */
 static inline void mark_block_free( void *ptr, SIZE_T size, DWORD flags )
 {
@@ -295,7 +341,8 @@ static void subheap_notify_free_all(SUBHEAP const *subheap)
         {
             ARENA_INUSE const *pArena = (ARENA_INUSE const *)ptr;
             if (pArena->magic == ARENA_INUSE_MAGIC) notify_free(pArena + 1);
-            else if (pArena->magic != ARENA_PENDING_MAGIC) ERR("bad inuse_magic @%p\n", pArena);
+            else if (pArena->magic != ARENA_PENDING_MAGIC && pArena->magic != ARENA_LFH_MAGIC)
+                ERR("bad inuse_magic @%p\n", pArena);
             ptr += sizeof(*pArena) + (pArena->size & ARENA_SIZE_MASK);
         }
     }
@@ -536,6 +583,8 @@ static inline BOOL HEAP_Commit( SUBHEAP *subheap, ARENA_INUSE *pArena, SIZE_T da
         return FALSE;
     }
     subheap->commitSize += size;
+    subheap->heap->stats.CommitCount++;
+    subheap->heap->stats.CommitSize += size;
     return TRUE;
 }
 
@@ -565,6 +614,8 @@ static inline BOOL HEAP_Decommit( SUBHEAP *subheap, void *ptr )
         return FALSE;
     }
     subheap->commitSize -= decommit_size;
+    subheap->heap->stats.DecommitCount++;
+    subheap->heap->stats.DecommitSize += decommit_size;
     return TRUE;
 }
 
@@ -667,6 +718,10 @@ static void HEAP_MakeInUseBlockFree( SUBHEAP *subheap, ARENA_INUSE *pArena )
     if ((char *)pFree + size < (char *)subheap->base + subheap->size)
         return;  /* Not the last block, so nothing more to do */
 
+    /* The front end looks at the sub-heaps without locking, keep them around */
+
+    if (heap->lfh) return;
+
     /* Free the whole sub-heap if it's empty and not the original one */
 
     if (((char *)pFree == (char *)subheap->base + subheap->headerSize) &&
@@ -738,6 +793,9 @@ static void *allocate_large_block( HEAP *heap, DWORD flags, SIZE_T size )
     arena->magic = ARENA_LARGE_MAGIC;
     mark_block_tail( (char *)(arena + 1) + size, block_size - sizeof(*arena) - size, flags );
     list_add_tail( &heap->large_list, &arena->entry );
+    heap->stats.LargeAllocCount++;
+    heap->stats.LargeBlockCount++;
+    heap->stats.LargeBlockSize += block_size;
     notify_alloc( arena + 1, size, flags & HEAP_ZERO_MEMORY );
     return arena + 1;
 }
@@ -753,6 +811,8 @@ static void free_large_block( HEAP *heap, DWORD flags, void *ptr )
     SIZE_T size = 0;
 
     list_remove( &arena->entry );
+    heap->stats.LargeBlockCount--;
+    heap->stats.LargeBlockSize -= arena->block_size;
     NtFreeVirtualMemory( NtCurrentProcess(), &address, &size, MEM_RELEASE );
 }
 
@@ -915,6 +975,12 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         subheap->magic      = SUBHEAP_MAGIC;
         subheap->headerSize = ROUND_SIZE( sizeof(SUBHEAP) );
         list_add_head( &heap->subheap_list, &subheap->entry );
+        heap->stats.SubheapCount++;
+        if (heap->lfh)
+        {
+            subheap->lfh_next = heap->lfh_subheaps;
+            InterlockedExchangePointer( (void **)&heap->lfh_subheaps, subheap );
+        }
     }
     else
     {
@@ -924,6 +990,10 @@ static SUBHEAP *HEAP_CreateSubHeap( HEAP *heap, LPVOID address, DWORD flags,
         heap->flags         = flags;
         heap->magic         = HEAP_MAGIC;
         heap->grow_size     = max( HEAP_DEF_SIZE, totalSize );
+        heap->lfh           = NULL;
+        heap->lfh_subheaps  = NULL;
+        memset( &heap->stats, 0, sizeof(heap->stats) );
+        heap->stats.SubheapCount = 1;
         list_init( &heap->subheap_list );
         list_init( &heap->large_list );
 
@@ -1006,12 +1076,14 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
 
     /* Find a suitable free list, and in it find a block large enough */
 
+    heap->stats.SearchCount++;
     ptr = &pEntry->arena.entry;
     while ((ptr = list_next( &heap->freeList[0].arena.entry, ptr )))
     {
         ARENA_FREE *pArena = LIST_ENTRY( ptr, ARENA_FREE, entry );
         SIZE_T arena_size = (pArena->size & ARENA_SIZE_MASK) +
                             sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
+        heap->stats.SearchSteps++;
         if (arena_size >= size)
         {
             subheap = HEAP_FindSubHeap( heap, pArena );
@@ -1057,6 +1129,187 @@ static ARENA_FREE *HEAP_FindFreeBlock( HEAP *heap, SIZE_T size,
 }
 
 
+/***********************************************************************
+ *           allocate_block
+ *
+ * Allocate an in-use block from the free lists. Heap must be locked.
+ */
+static ARENA_INUSE *allocate_block( HEAP *heap, SIZE_T rounded_size )
+{
+    ARENA_FREE *pArena;
+    ARENA_INUSE *pInUse;
+    SUBHEAP *subheap;
+
+    /* Locate a suitable free block */
+
+    if (!(pArena = HEAP_FindFreeBlock( heap, rounded_size, &subheap ))) return NULL;
+
+    /* Remove the arena from the free list */
+
+    list_remove( &pArena->entry );
+
+    /* Build the in-use arena */
+
+    pInUse = (ARENA_INUSE *)pArena;
+
+    /* in-use arena is smaller than free arena,
+     * so we have to add the difference to the size */
+    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
+    pInUse->magic = ARENA_INUSE_MAGIC;
+
+    /* Shrink the block */
+
+    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
+    return pInUse;
+}
+
+
+/***********************************************************************
+ *           get_lfh_bucket
+ *
+ * Get the front end bucket for blocks of a given arena size, if any.
+ */
+static inline SLIST_HEADER *get_lfh_bucket( const HEAP *heap, SIZE_T size )
+{
+    SLIST_HEADER *lfh = heap->lfh;
+
+    if (!lfh || size < HEAP_MIN_DATA_SIZE || size > ROUND_SIZE(HEAP_LFH_MAX_SIZE)) return NULL;
+    return lfh + (size - HEAP_MIN_DATA_SIZE) / ALIGNMENT;
+}
+
+
+/***********************************************************************
+ *           lfh_cache_block
+ *
+ * Store a block allocated from the backend in the front end. Heap must be locked.
+ */
+static void lfh_cache_block( HEAP *heap, ARENA_INUSE *arena )
+{
+    SLIST_HEADER *bucket = get_lfh_bucket( heap, arena->size & ARENA_SIZE_MASK );
+
+    if (!bucket)
+    {
+        HEAP_MakeInUseBlockFree( HEAP_FindSubHeap( heap, arena ), arena );
+        return;
+    }
+    arena->magic = ARENA_LFH_MAGIC;
+    RtlInterlockedPushEntrySList( bucket, (SLIST_ENTRY *)(arena + 1) );
+}
+
+
+/***********************************************************************
+ *           lfh_alloc_block
+ *
+ * Allocate a block from the front end, refilling the bucket from the
+ * backend if it's empty.
+ */
+static ARENA_INUSE *lfh_alloc_block( HEAP *heap, SLIST_HEADER *bucket, SIZE_T rounded_size )
+{
+    ARENA_INUSE *arena, *extra;
+    SLIST_ENTRY *entry;
+    unsigned int i;
+
+    if (!(entry = RtlInterlockedPopEntrySList( bucket )))
+    {
+        heap_lock( heap, 0 );
+        heap->stats.FrontEndRefillCount++;
+        if ((arena = allocate_block( heap, rounded_size )))
+        {
+            for (i = 1; i < HEAP_LFH_BATCH; i++)
+            {
+                if (!(extra = allocate_block( heap, rounded_size ))) break;
+                lfh_cache_block( heap, extra );
+            }
+            heap->stats.AllocCount[get_stats_class( rounded_size )] += i;
+        }
+        heap_unlock( heap, 0 );
+        return arena;
+    }
+
+    arena = (ARENA_INUSE *)entry - 1;
+    arena->magic = ARENA_INUSE_MAGIC;
+    return arena;
+}
+
+
+/***********************************************************************
+ *           lfh_find_subheap
+ *
+ * Find the sub-heap containing the committed arena header, without locking the heap.
+ */
+static SUBHEAP *lfh_find_subheap( HEAP *heap, const ARENA_INUSE *arena )
+{
+    SUBHEAP *subheap;
+
+    for (subheap = heap->lfh_subheaps; subheap; subheap = subheap->lfh_next)
+    {
+        if ((const char *)arena < (const char *)subheap->base + subheap->headerSize) continue;
+        if ((const char *)(arena + 1) > (const char *)subheap->base + subheap->commitSize) continue;
+        return subheap;
+    }
+    return NULL;
+}
+
+
+/***********************************************************************
+ *           lfh_free_block
+ *
+ * Return a block to the front end, without taking the heap lock unless
+ * the bucket is full. Return FALSE if the block has to go to the backend,
+ * which also takes care of reporting invalid pointers.
+ */
+static BOOL lfh_free_block( HEAP *heap, ARENA_INUSE *arena )
+{
+    ARENA_INUSE old_arena, new_arena, *block;
+    SLIST_HEADER *bucket;
+    SLIST_ENTRY *entry;
+    SUBHEAP *subheap;
+    SIZE_T size;
+    unsigned int i;
+
+    /* blocks must really be released when valgrind or free checking is tracking them */
+    if (heap->pending_free) return FALSE;
+    if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET) return FALSE;
+    /* sub-heaps are never released while the front end is enabled */
+    if (!(subheap = lfh_find_subheap( heap, arena ))) return FALSE;
+
+    old_arena = new_arena = *arena;
+    if (old_arena.magic != ARENA_INUSE_MAGIC || (old_arena.size & ARENA_FLAG_FREE)) return FALSE;
+    size = old_arena.size & ARENA_SIZE_MASK;
+    if ((const char *)(arena + 1) + size > (const char *)subheap->base + subheap->commitSize) return FALSE;
+    if (!(bucket = get_lfh_bucket( heap, size ))) return FALSE;
+
+    /* switch the magic atomically, so that concurrent double frees are caught by the backend */
+    new_arena.magic = ARENA_LFH_MAGIC;
+    if (InterlockedCompareExchange( (LONG *)arena + 1, ((LONG *)&new_arena)[1],
+                                    ((LONG *)&old_arena)[1] ) != ((LONG *)&old_arena)[1])
+        return FALSE;
+
+    if (RtlQueryDepthSList( bucket ) >= HEAP_LFH_MAX_DEPTH)
+    {
+        /* give a batch of blocks back to the backend */
+        heap_lock( heap, 0 );
+        heap->stats.FrontEndTrimCount++;
+        for (i = 0; i < HEAP_LFH_BATCH; i++)
+        {
+            if (!(entry = RtlInterlockedPopEntrySList( bucket ))) break;
+            block = (ARENA_INUSE *)entry - 1;
+            if (!(subheap = HEAP_FindSubHeap( heap, block )))
+            {
+                WARN( "Heap %p: pointer %p is not inside heap\n", heap, block + 1 );
+                continue;
+            }
+            HEAP_MakeInUseBlockFree( subheap, block );
+            heap->stats.FreeCount++;
+        }
+        heap_unlock( heap, 0 );
+    }
+
+    RtlInterlockedPushEntrySList( bucket, (SLIST_ENTRY *)(arena + 1) );
+    return TRUE;
+}
+
+
 /***********************************************************************
  *           HEAP_IsValidArenaPtr
  *
@@ -1213,7 +1466,8 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
     }
 
     /* Check magic number */
-    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC)
+    if (pArena->magic != ARENA_INUSE_MAGIC && pArena->magic != ARENA_PENDING_MAGIC &&
+        pArena->magic != ARENA_LFH_MAGIC)
     {
         if (quiet == NOISY) {
             ERR("Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, pArena->magic, pArena );
@@ -1300,6 +1554,10 @@ static BOOL HEAP_ValidateInUseArena( const SUBHEAP *subheap, const ARENA_INUSE *
             ptr++;
         }
     }
+    else if (pArena->magic == ARENA_LFH_MAGIC)
+    {
+        /* front end blocks hold stale data and the list link, nothing to check */
+    }
     else if (flags & HEAP_TAIL_CHECKING_ENABLED)
     {
         const unsigned char *data = (const unsigned char *)(pArena + 1) + size - pArena->unused_bytes;
@@ -1384,7 +1642,7 @@ static BOOL HEAP_IsRealArena( HEAP *heapPtr,   /* [in] ptr to the heap */
     ret = TRUE;
 
 done:
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
     return ret;
 }
 
@@ -1419,7 +1677,7 @@ static BOOL validate_block_pointer( HEAP *heap, SUBHEAP **ret_subheap, const ARE
         ret = HEAP_ValidateInUseArena( subheap, arena, QUIET );
     else if ((ULONG_PTR)arena % ALIGNMENT != ARENA_OFFSET)
         WARN( "Heap %p: unaligned arena pointer %p\n", subheap->heap, arena );
-    else if (arena->magic == ARENA_PENDING_MAGIC)
+    else if (arena->magic == ARENA_PENDING_MAGIC || arena->magic == ARENA_LFH_MAGIC)
         WARN( "Heap %p: block %p used after free\n", subheap->heap, arena + 1 );
     else if (arena->magic != ARENA_INUSE_MAGIC)
         WARN( "Heap %p: invalid in-use arena magic %08x for %p\n", subheap->heap, arena->magic, arena );
@@ -1492,7 +1750,7 @@ static void heap_set_debug_flags( HANDLE handle )
                 {
                     if (arena->magic == ARENA_PENDING_MAGIC)
                         mark_block_free( arena + 1, size, flags );
-                    else
+                    else if (arena->magic != ARENA_LFH_MAGIC)  /* front end blocks hold a list link */
                         mark_block_tail( (char *)(arena + 1) + size - arena->unused_bytes,
                                          arena->unused_bytes, flags );
                     ptr += sizeof(ARENA_INUSE) + size;
@@ -1650,9 +1908,8 @@ HANDLE WINAPI RtlDestroyHeap( HANDLE heap )
  */
 void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_T size )
 {
-    ARENA_FREE *pArena;
     ARENA_INUSE *pInUse;
-    SUBHEAP *subheap;
+    SLIST_HEADER *bucket;
     HEAP *heapPtr = HEAP_GetPtr( heap );
     SIZE_T rounded_size;
 
@@ -1669,50 +1926,44 @@ void * WINAPI DECLSPEC_HOTPATCH RtlAllocateHeap( HANDLE heap, ULONG flags, SIZE_
     }
     if (rounded_size < HEAP_MIN_DATA_SIZE) rounded_size = HEAP_MIN_DATA_SIZE;
 
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+    if ((bucket = get_lfh_bucket( heapPtr, rounded_size )) &&
+        (pInUse = lfh_alloc_block( heapPtr, bucket, rounded_size )))
+    {
+        pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
+        notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
+        initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
+        TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
+        return pInUse + 1;
+    }
+
+    heap_lock( heapPtr, flags );
 
     if (rounded_size >= HEAP_MIN_LARGE_BLOCK_SIZE && (flags & HEAP_GROWABLE))
     {
         void *ret = allocate_large_block( heap, flags, size );
-        if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+        if (ret) heapPtr->stats.AllocCount[get_stats_class( size )]++;
+        heap_unlock( heapPtr, flags );
         if (!ret && (flags & HEAP_GENERATE_EXCEPTIONS)) RtlRaiseStatus( STATUS_NO_MEMORY );
         TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, ret );
         return ret;
     }
 
-    /* Locate a suitable free block */
-
-    if (!(pArena = HEAP_FindFreeBlock( heapPtr, rounded_size, &subheap )))
+    if (!(pInUse = allocate_block( heapPtr, rounded_size )))
     {
         TRACE("(%p,%08x,%08lx): returning NULL\n",
                   heap, flags, size  );
-        if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+        heap_unlock( heapPtr, flags );
         if (flags & HEAP_GENERATE_EXCEPTIONS) RtlRaiseStatus( STATUS_NO_MEMORY );
         return NULL;
     }
 
-    /* Remove the arena from the free list */
-
-    list_remove( &pArena->entry );
-
-    /* Build the in-use arena */
-
-    pInUse = (ARENA_INUSE *)pArena;
-
-    /* in-use arena is smaller than free arena,
-     * so we have to add the difference to the size */
-    pInUse->size  = (pInUse->size & ~ARENA_FLAG_FREE) + sizeof(ARENA_FREE) - sizeof(ARENA_INUSE);
-    pInUse->magic = ARENA_INUSE_MAGIC;
-
-    /* Shrink the block */
-
-    HEAP_ShrinkBlock( subheap, pInUse, rounded_size );
     pInUse->unused_bytes = (pInUse->size & ARENA_SIZE_MASK) - size;
+    heapPtr->stats.AllocCount[get_stats_class( size )]++;
 
     notify_alloc( pInUse + 1, size, flags & HEAP_ZERO_MEMORY );
     initialize_block( pInUse + 1, size, pInUse->unused_bytes, flags );
 
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
 
     TRACE("(%p,%08x,%08lx): returning %p\n", heap, flags, size, pInUse + 1 );
     return pInUse + 1;
@@ -1752,26 +2003,35 @@ BOOLEAN WINAPI DECLSPEC_HOTPATCH RtlFreeHeap( HANDLE heap, ULONG flags, void *pt
 
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+    pInUse  = (ARENA_INUSE *)ptr - 1;
+
+    if (heapPtr->lfh && lfh_free_block( heapPtr, pInUse ))
+    {
+        notify_free( ptr );
+        TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
+        return TRUE;
+    }
+
+    heap_lock( heapPtr, flags );
 
     /* Inform valgrind we are trying to free memory, so it can throw up an error message */
     notify_free( ptr );
 
     /* Some sanity checks */
-    pInUse  = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pInUse )) goto error;
+    heapPtr->stats.FreeCount++;
 
     if (!subheap)
         free_large_block( heapPtr, flags, ptr );
     else
         HEAP_MakeInUseBlockFree( subheap, pInUse );
 
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
     TRACE("(%p,%08x,%p): returning TRUE\n", heap, flags, ptr );
     return TRUE;
 
 error:
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
     RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
     TRACE("(%p,%08x,%p): returning FALSE\n", heap, flags, ptr );
     return FALSE;
@@ -1813,7 +2073,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
     flags &= HEAP_GENERATE_EXCEPTIONS | HEAP_NO_SERIALIZE | HEAP_ZERO_MEMORY |
              HEAP_REALLOC_IN_PLACE_ONLY;
     flags |= heapPtr->flags;
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+    heap_lock( heapPtr, flags );
 
     rounded_size = ROUND_SIZE(size) + HEAP_TAIL_EXTRA_SIZE(flags);
     if (rounded_size < size) goto oom;  /* overflow */
@@ -1821,6 +2081,7 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
 
     pArena = (ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pArena )) goto error;
+    heapPtr->stats.ReAllocCount++;
     if (!subheap)
     {
         if (!(ret = realloc_large_block( heapPtr, flags, ptr, size ))) goto oom;
@@ -1907,19 +2168,19 @@ PVOID WINAPI RtlReAllocateHeap( HANDLE heap, ULONG flags, PVOID ptr, SIZE_T size
 
     ret = pArena + 1;
 done:
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
     TRACE("(%p,%08x,%p,%08lx): returning %p\n", heap, flags, ptr, size, ret );
     return ret;
 
 oom:
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
     if (flags & HEAP_GENERATE_EXCEPTIONS) RtlRaiseStatus( STATUS_NO_MEMORY );
     RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_NO_MEMORY );
     TRACE("(%p,%08x,%p,%08lx): returning NULL\n", heap, flags, ptr, size );
     return NULL;
 
 error:
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
     RtlSetLastWin32ErrorAndNtStatusFromNtStatus( STATUS_INVALID_PARAMETER );
     TRACE("(%p,%08x,%p,%08lx): returning NULL\n", heap, flags, ptr, size );
     return NULL;
@@ -2022,7 +2283,7 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
     }
     flags &= HEAP_NO_SERIALIZE;
     flags |= heapPtr->flags;
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlEnterCriticalSection( &heapPtr->critSection );
+    heap_lock( heapPtr, flags );
 
     pArena = (const ARENA_INUSE *)ptr - 1;
     if (!validate_block_pointer( heapPtr, &subheap, pArena ))
@@ -2039,7 +2300,7 @@ SIZE_T WINAPI RtlSizeHeap( HANDLE heap, ULONG flags, const void *ptr )
     {
         ret = (pArena->size & ARENA_SIZE_MASK) - pArena->unused_bytes;
     }
-    if (!(flags & HEAP_NO_SERIALIZE)) RtlLeaveCriticalSection( &heapPtr->critSection );
+    heap_unlock( heapPtr, flags );
 
     TRACE("(%p,%08x,%p): returning %08lx\n", heap, flags, ptr, ret );
     return ret;
@@ -2119,7 +2380,8 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         }
 
         if (((ARENA_INUSE *)ptr - 1)->magic == ARENA_INUSE_MAGIC ||
-            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC)
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_PENDING_MAGIC ||
+            ((ARENA_INUSE *)ptr - 1)->magic == ARENA_LFH_MAGIC)
         {
             ARENA_INUSE *pArena = (ARENA_INUSE *)ptr - 1;
             ptr += pArena->size & ARENA_SIZE_MASK;
@@ -2167,7 +2429,7 @@ NTSTATUS WINAPI RtlWalkHeap( HANDLE heap, PVOID entry_ptr )
         entry->lpData = pArena + 1;
         entry->cbData = pArena->size & ARENA_SIZE_MASK;
         entry->cbOverhead = sizeof(ARENA_INUSE);
-        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC) ?
+        entry->wFlags = (pArena->magic == ARENA_PENDING_MAGIC || pArena->magic == ARENA_LFH_MAGIC) ?
                         PROCESS_HEAP_UNCOMMITTED_RANGE : PROCESS_HEAP_ENTRY_BUSY;
         /* FIXME: can't handle PROCESS_HEAP_ENTRY_MOVEABLE
         and PROCESS_HEAP_ENTRY_DDESHARE yet */
@@ -2226,12 +2488,74 @@ ULONG WINAPI RtlGetProcessHeaps( ULONG count, HANDLE *heaps )
     return total;
 }
 
+/***********************************************************************
+ *           dump_heap_statistics
+ */
+static void dump_heap_statistics( HEAP *heap )
+{
+    const HEAP_WINE_STATISTICS *stats = &heap->stats;
+    LARGE_INTEGER freq;
+    unsigned int i;
+
+    NtQueryPerformanceCounter( NULL, &freq );
+    MESSAGE( "heap %p: flags %08x%s, %llu subheaps, %llu large blocks (%llu bytes, %llu total)\n",
+             heap, heap->flags, heap->lfh ? " lfh" : "", (ULONGLONG)stats->SubheapCount,
+             (ULONGLONG)stats->LargeBlockCount, (ULONGLONG)stats->LargeBlockSize,
+             (ULONGLONG)stats->LargeAllocCount );
+    for (i = 0; i < HEAP_STATS_NB_CLASSES; i++)
+    {
+        if (!stats->AllocCount[i]) continue;
+        if (i < HEAP_STATS_NB_CLASSES - 1)
+            MESSAGE( "  allocs <= %u: %llu\n", 16u << i, (ULONGLONG)stats->AllocCount[i] );
+        else
+            MESSAGE( "  allocs > %u: %llu\n", 16u << (i - 1), (ULONGLONG)stats->AllocCount[i] );
+    }
+    MESSAGE( "  frees %llu, reallocs %llu, searches %llu (%llu steps)\n",
+             (ULONGLONG)stats->FreeCount, (ULONGLONG)stats->ReAllocCount,
+             (ULONGLONG)stats->SearchCount, (ULONGLONG)stats->SearchSteps );
+    MESSAGE( "  commits %llu (%llu bytes), decommits %llu (%llu bytes)\n",
+             (ULONGLONG)stats->CommitCount, (ULONGLONG)stats->CommitSize,
+             (ULONGLONG)stats->DecommitCount, (ULONGLONG)stats->DecommitSize );
+    MESSAGE( "  front end refills %llu, trims %llu\n",
+             (ULONGLONG)stats->FrontEndRefillCount, (ULONGLONG)stats->FrontEndTrimCount );
+    MESSAGE( "  lock contention %llu times, %llu us\n", (ULONGLONG)stats->ContentionCount,
+             (ULONGLONG)(stats->ContentionTime * 1000000 / freq.QuadPart) );
+}
+
+
+/***********************************************************************
+ *           heap_report_statistics
+ *
+ * Dump the statistics of all heaps if WINEHEAPSTATS is set.
+ */
+void heap_report_statistics(void)
+{
+    UNICODE_STRING name, value;
+    WCHAR buffer[8];
+    HEAP *heap;
+
+    RtlInitUnicodeString( &name, L"WINEHEAPSTATS" );
+    value.Buffer = buffer;
+    value.Length = 0;
+    value.MaximumLength = sizeof(buffer);
+    if (RtlQueryEnvironmentVariable_U( NULL, &name, &value )) return;
+    if (!value.Length || buffer[0] == '0') return;
+
+    RtlEnterCriticalSection( &processHeap->critSection );
+    dump_heap_statistics( processHeap );
+    LIST_FOR_EACH_ENTRY( heap, &processHeap->entry, HEAP, entry ) dump_heap_statistics( heap );
+    RtlLeaveCriticalSection( &processHeap->critSection );
+}
+
+
 /***********************************************************************
  *           RtlQueryHeapInformation    (NTDLL.@)
  */
 NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class,
                                          PVOID info, SIZE_T size_in, PSIZE_T size_out)
 {
+    HEAP *heapPtr;
+
     switch (info_class)
     {
     case HeapCompatibilityInformation:
@@ -2240,7 +2564,20 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
         if (size_in < sizeof(ULONG))
             return STATUS_BUFFER_TOO_SMALL;
 
-        *(ULONG *)info = 0; /* standard heap */
+        heapPtr = HEAP_GetPtr( heap );
+        *(ULONG *)info = heapPtr && heapPtr->lfh ? HEAP_LFH : HEAP_STD;
+        return STATUS_SUCCESS;
+
+    case HeapWineStatistics:
+        if (size_out) *size_out = sizeof(HEAP_WINE_STATISTICS);
+
+        if (size_in < sizeof(HEAP_WINE_STATISTICS))
+            return STATUS_BUFFER_TOO_SMALL;
+
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+        heap_lock( heapPtr, heapPtr->flags );
+        memcpy( info, &heapPtr->stats, sizeof(heapPtr->stats) );
+        heap_unlock( heapPtr, heapPtr->flags );
         return STATUS_SUCCESS;
 
     default:
@@ -2249,11 +2586,71 @@ NTSTATUS WINAPI RtlQueryHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS inf
     }
 }
 
+/***********************************************************************
+ *           heap_enable_lfh
+ *
+ * Enable the low-fragmentation front end on a heap.
+ */
+static NTSTATUS heap_enable_lfh( HEAP *heap )
+{
+    SLIST_HEADER *lfh;
+    SUBHEAP *subheap;
+    unsigned int i;
+
+    /* the front end bypasses the validation and debugging features of the backend */
+    if (heap->flags & (HEAP_NO_SERIALIZE | HEAP_VALIDATE | HEAP_TAIL_CHECKING_ENABLED |
+                       HEAP_FREE_CHECKING_ENABLED | HEAP_PAGE_ALLOCS) || heap->pending_free)
+        return STATUS_UNSUCCESSFUL;
+    if (heap->lfh) return STATUS_SUCCESS;
+
+    RtlEnterCriticalSection( &heap->critSection );
+    if (!heap->lfh)
+    {
+        /* the buckets are freed along with the heap */
+        if (!(lfh = RtlAllocateHeap( heap, 0, HEAP_LFH_NB_BUCKETS * sizeof(*lfh) )))
+        {
+            RtlLeaveCriticalSection( &heap->critSection );
+            return STATUS_NO_MEMORY;
+        }
+        for (i = 0; i < HEAP_LFH_NB_BUCKETS; i++) RtlInitializeSListHead( &lfh[i] );
+        LIST_FOR_EACH_ENTRY( subheap, &heap->subheap_list, SUBHEAP, entry )
+        {
+            subheap->lfh_next = heap->lfh_subheaps;
+            heap->lfh_subheaps = subheap;
+        }
+        InterlockedExchangePointer( (void **)&heap->lfh, lfh );
+    }
+    RtlLeaveCriticalSection( &heap->critSection );
+    return STATUS_SUCCESS;
+}
+
 /***********************************************************************
  *           RtlSetHeapInformation    (NTDLL.@)
  */
 NTSTATUS WINAPI RtlSetHeapInformation( HANDLE heap, HEAP_INFORMATION_CLASS info_class, PVOID info, SIZE_T size)
 {
-    FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
-    return STATUS_SUCCESS;
+    HEAP *heapPtr;
+
+    switch (info_class)
+    {
+    case HeapCompatibilityInformation:
+        if (size < sizeof(ULONG)) return STATUS_BUFFER_TOO_SMALL;
+        if (!(heapPtr = HEAP_GetPtr( heap ))) return STATUS_INVALID_HANDLE;
+
+        switch (*(ULONG *)info)
+        {
+        case HEAP_STD:
+            return heapPtr->lfh ? STATUS_UNSUCCESSFUL : STATUS_SUCCESS;
+        case HEAP_LFH:
+            TRACE("enabling low-fragmentation front end for heap %p\n", heap);
+            return heap_enable_lfh( heapPtr );
+        default:
+            FIXME("%p: unsupported heap compatibility mode %u\n", heap, *(ULONG *)info);
+            return STATUS_UNSUCCESSFUL;
+        }
+
+    default:
+        FIXME("%p %d %p %ld stub\n", heap, info_class, info, size);
+        return STATUS_SUCCESS;
+    }
 }
@@ -133,6 +133,11 @@ typedef struct _wine_modref
 {
     LDR_DATA_TABLE_ENTRY  ldr;
     struct file_id        id;
+    struct list           basename_entry;  /* entry in basename_hash */
+    struct list           fullname_entry;  /* entry in fullname_hash */
+    struct list           fileid_entry;    /* entry in fileid_hash */
+    DWORD                *export_hash;     /* hash table of export name indexes, built on demand */
+    DWORD                 export_hash_size;
     int                   alloc_deps;
     int                   nDeps;
     struct _wine_modref **deps;
@@ -184,12 +189,18 @@ static WINE_MODREF *cached_modref;
 static WINE_MODREF *current_modref;
 static WINE_MODREF *last_failed_modref;
 
+/* hash tables of the loaded modules, protected by loader_section */
+#define MODULE_HASH_SIZE 64
+static struct list basename_hash[MODULE_HASH_SIZE];
+static struct list fullname_hash[MODULE_HASH_SIZE];
+static struct list fileid_hash[MODULE_HASH_SIZE];
+
 static NTSTATUS load_dll( const WCHAR *load_path, const WCHAR *libname, const WCHAR *default_ext,
                           DWORD flags, WINE_MODREF** pwm );
 static NTSTATUS process_attach( WINE_MODREF *wm, LPVOID lpReserved );
 static FARPROC find_ordinal_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
                                     DWORD exp_size, DWORD ordinal, LPCWSTR load_path );
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+static FARPROC find_named_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
                                   DWORD exp_size, const char *name, int hint, LPCWSTR load_path );
 
 /* convert PE image VirtualAddress to Real Address */
@@ -497,6 +508,72 @@ static WINE_MODREF *get_modref( HMODULE hmod )
 }
 
 
+/* case-insensitive hash of a module name */
+static ULONG hash_module_name( const UNICODE_STRING *name )
+{
+    ULONG hash;
+
+    RtlHashUnicodeString( name, TRUE, HASH_STRING_ALGORITHM_X65599, &hash );
+    return hash;
+}
+
+static ULONG hash_file_id( const struct file_id *id )
+{
+    ULONG i, hash = 0;
+
+    for (i = 0; i < sizeof(id->ObjectId); i++) hash = hash * 65599 + id->ObjectId[i];
+    return hash;
+}
+
+
+/**********************************************************************
+ *	    init_module_hash
+ *
+ * Initialize the module hash tables.
+ */
+static void init_module_hash(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < MODULE_HASH_SIZE; i++)
+    {
+        list_init( &basename_hash[i] );
+        list_init( &fullname_hash[i] );
+        list_init( &fileid_hash[i] );
+    }
+}
+
+
+/**********************************************************************
+ *	    add_module_hash
+ *
+ * Add a module to the hash tables, once its names and file id are set.
+ * The loader_section must be locked while calling this function
+ */
+static void add_module_hash( WINE_MODREF *wm )
+{
+    wm->ldr.BaseNameHashValue = hash_module_name( &wm->ldr.BaseDllName );
+    list_add_tail( &basename_hash[wm->ldr.BaseNameHashValue % MODULE_HASH_SIZE], &wm->basename_entry );
+    list_add_tail( &fullname_hash[hash_module_name( &wm->ldr.FullDllName ) % MODULE_HASH_SIZE],
+                   &wm->fullname_entry );
+    list_add_tail( &fileid_hash[hash_file_id( &wm->id ) % MODULE_HASH_SIZE], &wm->fileid_entry );
+}
+
+
+/**********************************************************************
+ *	    remove_module_hash
+ *
+ * Remove a module from the hash tables.
+ * The loader_section must be locked while calling this function
+ */
+static void remove_module_hash( WINE_MODREF *wm )
+{
+    list_remove( &wm->basename_entry );
+    list_remove( &wm->fullname_entry );
+    list_remove( &wm->fileid_entry );
+}
+
+
 /**********************************************************************
  *	    find_basename_module
  *
@@ -505,21 +582,20 @@ static WINE_MODREF *get_modref( HMODULE hmod )
  */
 static WINE_MODREF *find_basename_module( LPCWSTR name )
 {
-    PLIST_ENTRY mark, entry;
     UNICODE_STRING name_str;
+    WINE_MODREF *wm;
 
     RtlInitUnicodeString( &name_str, name );
 
     if (cached_modref && RtlEqualUnicodeString( &name_str, &cached_modref->ldr.BaseDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    LIST_FOR_EACH_ENTRY( wm, &basename_hash[hash_module_name( &name_str ) % MODULE_HASH_SIZE],
+                         WINE_MODREF, basename_entry )
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name_str, &mod->BaseDllName, TRUE ))
+        if (RtlEqualUnicodeString( &name_str, &wm->ldr.BaseDllName, TRUE ))
         {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+            cached_modref = wm;
             return cached_modref;
         }
     }
@@ -535,8 +611,8 @@ static WINE_MODREF *find_basename_module( LPCWSTR name )
  */
 static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
 {
-    PLIST_ENTRY mark, entry;
     UNICODE_STRING name = *nt_name;
+    WINE_MODREF *wm;
 
     if (name.Length <= 4 * sizeof(WCHAR)) return NULL;
     name.Length -= 4 * sizeof(WCHAR);  /* for \??\ prefix */
@@ -545,13 +621,12 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
     if (cached_modref && RtlEqualUnicodeString( &name, &cached_modref->ldr.FullDllName, TRUE ))
         return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    LIST_FOR_EACH_ENTRY( wm, &fullname_hash[hash_module_name( &name ) % MODULE_HASH_SIZE],
+                         WINE_MODREF, fullname_entry )
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD(entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
-        if (RtlEqualUnicodeString( &name, &mod->FullDllName, TRUE ))
+        if (RtlEqualUnicodeString( &name, &wm->ldr.FullDllName, TRUE ))
         {
-            cached_modref = CONTAINING_RECORD(mod, WINE_MODREF, ldr);
+            cached_modref = wm;
             return cached_modref;
         }
     }
@@ -567,16 +642,12 @@ static WINE_MODREF *find_fullname_module( const UNICODE_STRING *nt_name )
  */
 static WINE_MODREF *find_fileid_module( const struct file_id *id )
 {
-    LIST_ENTRY *mark, *entry;
+    WINE_MODREF *wm;
 
     if (cached_modref && !memcmp( &cached_modref->id, id, sizeof(*id) )) return cached_modref;
 
-    mark = &NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList;
-    for (entry = mark->Flink; entry != mark; entry = entry->Flink)
+    LIST_FOR_EACH_ENTRY( wm, &fileid_hash[hash_file_id( id ) % MODULE_HASH_SIZE], WINE_MODREF, fileid_entry )
     {
-        LDR_DATA_TABLE_ENTRY *mod = CONTAINING_RECORD( entry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks );
-        WINE_MODREF *wm = CONTAINING_RECORD( mod, WINE_MODREF, ldr );
-
         if (!memcmp( &wm->id, id, sizeof(*id) ))
         {
             cached_modref = wm;
@@ -670,7 +741,7 @@ static FARPROC find_forwarded_export( HMODULE module, const char *forward, LPCWS
             proc = find_ordinal_export( wm->ldr.DllBase, exports, exp_size,
                                         atoi(name+1) - exports->Base, load_path );
         } else
-            proc = find_named_export( wm->ldr.DllBase, exports, exp_size, name, -1, load_path );
+            proc = find_named_export( wm, exports, exp_size, name, -1, load_path );
     }
 
     if (!proc)
@@ -749,15 +820,75 @@ static int find_name_in_exports( HMODULE module, const IMAGE_EXPORT_DIRECTORY *e
 }
 
 
+static ULONG hash_export_name( const char *name )
+{
+    ULONG hash = 0;
+
+    while (*name) hash = hash * 65599 + (unsigned char)*name++;
+    return hash;
+}
+
+
+/*************************************************************************
+ *		build_export_hash
+ *
+ * Build the hash table of the export names of a module.
+ * The loader_section must be locked while calling this function.
+ */
+static void build_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports, DWORD exp_size )
+{
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    DWORD i, pos, size = 16;
+
+    /* the name table is part of the export data, don't trust larger counts */
+    if (exports->NumberOfNames > exp_size / sizeof(DWORD)) return;
+
+    while (size < 2 * exports->NumberOfNames) size *= 2;
+    if (!(wm->export_hash = RtlAllocateHeap( GetProcessHeap(), HEAP_ZERO_MEMORY,
+                                             size * sizeof(*wm->export_hash) )))
+        return;
+    wm->export_hash_size = size;
+
+    for (i = 0; i < exports->NumberOfNames; i++)
+    {
+        pos = hash_export_name( get_rva( wm->ldr.DllBase, names[i] )) & (size - 1);
+        while (wm->export_hash[pos]) pos = (pos + 1) & (size - 1);
+        wm->export_hash[pos] = i + 1;
+    }
+}
+
+
+/*************************************************************************
+ *		find_name_in_export_hash
+ *
+ * Helper for find_named_export.
+ */
+static int find_name_in_export_hash( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
+                                     const char *name )
+{
+    const WORD *ordinals = get_rva( wm->ldr.DllBase, exports->AddressOfNameOrdinals );
+    const DWORD *names = get_rva( wm->ldr.DllBase, exports->AddressOfNames );
+    DWORD index, pos = hash_export_name( name ) & (wm->export_hash_size - 1);
+
+    while ((index = wm->export_hash[pos]))
+    {
+        if (!strcmp( get_rva( wm->ldr.DllBase, names[index - 1] ), name )) return ordinals[index - 1];
+        pos = (pos + 1) & (wm->export_hash_size - 1);
+    }
+    return -1;
+}
+
+
 /*************************************************************************
  *		find_named_export
  *
  * Find an exported function by name.
  * The loader_section must be locked while calling this function.
  */
-static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *exports,
+static FARPROC find_named_export( WINE_MODREF *wm, const IMAGE_EXPORT_DIRECTORY *exports,
                                   DWORD exp_size, const char *name, int hint, LPCWSTR load_path )
 {
+    HMODULE module = wm->ldr.DllBase;
     const WORD *ordinals = get_rva( module, exports->AddressOfNameOrdinals );
     const DWORD *names = get_rva( module, exports->AddressOfNames );
     int ordinal;
@@ -770,8 +901,12 @@ static FARPROC find_named_export( HMODULE module, const IMAGE_EXPORT_DIRECTORY *
             return find_ordinal_export( module, exports, exp_size, ordinals[hint], load_path );
     }
 
-    /* then do a binary search */
-    if ((ordinal = find_name_in_exports( module, exports, name )) == -1) return NULL;
+    /* then look it up in the hash table for modules with many exports,
+     * or fall back to a binary search */
+    if (!wm->export_hash && exports->NumberOfNames >= 64) build_export_hash( wm, exports, exp_size );
+    if (wm->export_hash) ordinal = find_name_in_export_hash( wm, exports, name );
+    else ordinal = find_name_in_exports( module, exports, name );
+    if (ordinal == -1) return NULL;
     return find_ordinal_export( module, exports, exp_size, ordinal, load_path );
 
 }
@@ -798,6 +933,69 @@ void * WINAPI RtlFindExportedRoutineByName( HMODULE module, const char *name )
 }
 
 
+/*************************************************************************
+ *		is_bound_module_valid
+ *
+ * Check that a module is loaded with the time stamp and address it was bound to.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL is_bound_module_valid( const WINE_MODREF *wm, DWORD timestamp )
+{
+    const IMAGE_NT_HEADERS *nt = RtlImageNtHeader( wm->ldr.DllBase );
+
+    return timestamp && wm->ldr.TimeDateStamp == timestamp &&
+           (void *)nt->OptionalHeader.ImageBase == wm->ldr.DllBase;
+}
+
+
+/*************************************************************************
+ *		is_import_bound
+ *
+ * Check whether the import address table of a descriptor has been prebound
+ * to the currently loaded module, in which case it can be used as is.
+ * The loader_section must be locked while calling this function.
+ */
+static BOOL is_import_bound( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, const WINE_MODREF *wm )
+{
+    const IMAGE_BOUND_IMPORT_DESCRIPTOR *bound;
+    const IMAGE_BOUND_FORWARDER_REF *ref;
+    const char *base, *name = get_rva( module, descr->Name );
+    WCHAR buffer[32];
+    WINE_MODREF *fwd;
+    ULONG i, len, size;
+
+    /* only new-style binding records the time stamps of forwarded modules */
+    if (descr->TimeDateStamp != ~0u) return FALSE;
+    /* relay and snoop need to see all the imports */
+    if (TRACE_ON(relay) || TRACE_ON(snoop)) return FALSE;
+    if (!(base = RtlImageDirectoryEntryToData( module, TRUE, IMAGE_DIRECTORY_ENTRY_BOUND_IMPORT, &size )))
+        return FALSE;
+
+    bound = (const IMAGE_BOUND_IMPORT_DESCRIPTOR *)base;
+    while ((const char *)(bound + 1) <= base + size && bound->OffsetModuleName)
+    {
+        ref = (const IMAGE_BOUND_FORWARDER_REF *)(bound + 1);
+        if ((const char *)(ref + bound->NumberOfModuleForwarderRefs) > base + size) return FALSE;
+
+        if (!_stricmp( base + bound->OffsetModuleName, name ))
+        {
+            if (!is_bound_module_valid( wm, bound->TimeDateStamp )) return FALSE;
+            for (i = 0; i < bound->NumberOfModuleForwarderRefs; i++)
+            {
+                len = strlen( base + ref[i].OffsetModuleName );
+                if (len >= ARRAY_SIZE(buffer)) return FALSE;
+                ascii_to_unicode( buffer, base + ref[i].OffsetModuleName, len + 1 );
+                if (!(fwd = find_basename_module( buffer ))) return FALSE;
+                if (!is_bound_module_valid( fwd, ref[i].TimeDateStamp )) return FALSE;
+            }
+            return TRUE;
+        }
+        bound = (const IMAGE_BOUND_IMPORT_DESCRIPTOR *)(ref + bound->NumberOfModuleForwarderRefs);
+    }
+    return FALSE;
+}
+
+
 /*************************************************************************
  *		import_dll
  *
@@ -862,6 +1060,13 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         return FALSE;
     }
 
+    if (is_import_bound( module, descr, wmImp ))
+    {
+        TRACE_(imports)( "using bound imports for %s\n", name );
+        *pwm = wmImp;
+        return TRUE;
+    }
+
     /* unprotect the import address table since it can be located in
      * readonly section */
     while (import_list[protect_size].u1.Ordinal) protect_size++;
@@ -920,7 +1125,7 @@ static BOOL import_dll( HMODULE module, const IMAGE_IMPORT_DESCRIPTOR *descr, LP
         {
             IMAGE_IMPORT_BY_NAME *pe_name;
             pe_name = get_rva( module, (DWORD)import_list->u1.AddressOfData );
-            thunk_list->u1.Function = (ULONG_PTR)find_named_export( imp_mod, exports, exp_size,
+            thunk_list->u1.Function = (ULONG_PTR)find_named_export( wmImp, exports, exp_size,
                                                                     (const char*)pe_name->Name,
                                                                     pe_name->Hint, load_path );
             if (!thunk_list->u1.Function)
@@ -1208,7 +1413,8 @@ static NTSTATUS fixup_imports( WINE_MODREF *wm, LPCWSTR load_path )
  * Allocate a WINE_MODREF structure and add it to the process list
  * The loader_section must be locked while calling this function.
  */
-static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name, BOOL builtin )
+static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name,
+                                  const struct file_id *id, BOOL builtin )
 {
     WCHAR *buffer;
     WINE_MODREF *wm;
@@ -1245,10 +1451,13 @@ static WINE_MODREF *alloc_module( HMODULE hModule, const UNICODE_STRING *nt_name
             wm->ldr.EntryPoint = (char *)hModule + nt->OptionalHeader.AddressOfEntryPoint;
     }
 
+    if (id) wm->id = *id;
+
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InLoadOrderModuleList,
                    &wm->ldr.InLoadOrderLinks);
     InsertTailList(&NtCurrentTeb()->Peb->LdrData->InMemoryOrderModuleList,
                    &wm->ldr.InMemoryOrderLinks);
+    add_module_hash( wm );
     /* wait until init is called for inserting into InInitializationOrderModuleList */
 
     if (!(nt->OptionalHeader.DllCharacteristics & IMAGE_DLLCHARACTERISTICS_NX_COMPAT))
@@ -1733,15 +1942,16 @@ NTSTATUS WINAPI LdrGetProcedureAddress(HMODULE module, const ANSI_STRING *name,
     IMAGE_EXPORT_DIRECTORY *exports;
     DWORD exp_size;
     NTSTATUS ret = STATUS_PROCEDURE_NOT_FOUND;
+    WINE_MODREF *wm;
 
     RtlEnterCriticalSection( &loader_section );
 
     /* check if the module itself is invalid to return the proper error */
-    if (!get_modref( module )) ret = STATUS_DLL_NOT_FOUND;
+    if (!(wm = get_modref( module ))) ret = STATUS_DLL_NOT_FOUND;
     else if ((exports = RtlImageDirectoryEntryToData( module, TRUE,
                                                       IMAGE_DIRECTORY_ENTRY_EXPORT, &exp_size )))
     {
-        void *proc = name ? find_named_export( module, exports, exp_size, name->Buffer, -1, NULL )
+        void *proc = name ? find_named_export( wm, exports, exp_size, name->Buffer, -1, NULL )
                           : find_ordinal_export( module, exports, exp_size, ord - exports->Base, NULL );
         if (proc)
         {
@@ -1906,9 +2116,8 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
 
     /* create the MODREF */
 
-    if (!(wm = alloc_module( *module, nt_name, is_builtin ))) return STATUS_NO_MEMORY;
+    if (!(wm = alloc_module( *module, nt_name, id, is_builtin ))) return STATUS_NO_MEMORY;
 
-    if (id) wm->id = *id;
     if (image_info->LoaderFlags) wm->ldr.Flags |= LDR_COR_IMAGE;
     if (image_info->u.s.ComPlusILOnly) wm->ldr.Flags |= LDR_COR_ILONLY;
 
@@ -1929,6 +2138,7 @@ static NTSTATUS build_module( LPCWSTR load_path, const UNICODE_STRING *nt_name,
             /* the module has only be inserted in the load & memory order lists */
             RemoveEntryList(&wm->ldr.InLoadOrderLinks);
             RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+            remove_module_hash( wm );
 
             /* FIXME: there are several more dangling references
              * left. Including dlls loaded by this dll before the
@@ -1977,7 +2187,7 @@ static void build_ntdll_module(void)
     RtlInitUnicodeString( &nt_name, L"\\??\\C:\\windows\\system32\\ntdll.dll" );
     NtQueryVirtualMemory( GetCurrentProcess(), build_ntdll_module, MemoryBasicInformation,
                           &meminfo, sizeof(meminfo), NULL );
-    wm = alloc_module( meminfo.AllocationBase, &nt_name, TRUE );
+    wm = alloc_module( meminfo.AllocationBase, &nt_name, NULL, TRUE );
     assert( wm );
     wm->ldr.Flags &= ~LDR_DONT_RESOLVE_REFS;
     if (TRACE_ON(relay)) RELAY_SetupDLL( meminfo.AllocationBase );
@@ -3431,6 +3641,7 @@ void WINAPI LdrShutdownProcess(void)
         RtlProcessFlsData( NtCurrentTeb()->FlsSlots, 1 );
 
     process_detach();
+    if (!detaching) heap_report_statistics();
 }
 
 
@@ -3512,6 +3723,7 @@ static void free_modref( WINE_MODREF *wm )
 {
     RemoveEntryList(&wm->ldr.InLoadOrderLinks);
     RemoveEntryList(&wm->ldr.InMemoryOrderLinks);
+    remove_module_hash( wm );
     if (wm->ldr.InInitializationOrderLinks.Flink)
         RemoveEntryList(&wm->ldr.InInitializationOrderLinks);
 
@@ -3527,6 +3739,7 @@ static void free_modref( WINE_MODREF *wm )
     if (cached_modref == wm) cached_modref = NULL;
     RtlFreeUnicodeString( &wm->ldr.FullDllName );
     RtlFreeHeap( GetProcessHeap(), 0, wm->deps );
+    RtlFreeHeap( GetProcessHeap(), 0, wm->export_hash );
     RtlFreeHeap( GetProcessHeap(), 0, wm );
 }
 
@@ -3875,6 +4088,7 @@ void WINAPI LdrInitializeThunk( CONTEXT *context, ULONG_PTR unknown2, ULONG_PTR
         load_global_options();
         version_init();
 
+        init_module_hash();
         wm = build_main_module();
         wm->ldr.LoadCount = -1;
 
@@ -0,0 +1,96 @@
+/*
+ * Unit test suite for ntdll heap functions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA
+ */
+
+#include "ntdll_test.h"
+
+static ULONGLONG total_alloc_count( const HEAP_WINE_STATISTICS *stats )
+{
+    ULONGLONG ret = 0;
+    unsigned int i;
+
+    for (i = 0; i < HEAP_STATS_NB_CLASSES; i++) ret += stats->AllocCount[i];
+    return ret;
+}
+
+static void test_wine_statistics(void)
+{
+    HEAP_WINE_STATISTICS before, after;
+    void *ptrs[10], *large;
+    NTSTATUS status;
+    SIZE_T size;
+    HANDLE heap;
+    unsigned int i;
+
+    heap = RtlCreateHeap( HEAP_GROWABLE, NULL, 0, 0, NULL, NULL );
+    ok( heap != NULL, "RtlCreateHeap failed\n" );
+
+    size = 0xdeadbeef;
+    status = RtlQueryHeapInformation( heap, HeapWineStatistics, &before, sizeof(before), &size );
+    if (status == STATUS_INVALID_INFO_CLASS || status == STATUS_INVALID_PARAMETER)
+    {
+        win_skip( "HeapWineStatistics not supported\n" );
+        RtlDestroyHeap( heap );
+        return;
+    }
+    ok( !status, "got status %#x\n", status );
+    ok( size == sizeof(before), "got size %lu\n", size );
+
+    status = RtlQueryHeapInformation( heap, HeapWineStatistics, &before, sizeof(before) - 1, &size );
+    ok( status == STATUS_BUFFER_TOO_SMALL, "got status %#x\n", status );
+
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++)
+    {
+        ptrs[i] = RtlAllocateHeap( heap, 0, 32 );
+        ok( ptrs[i] != NULL, "RtlAllocateHeap failed\n" );
+    }
+    large = RtlAllocateHeap( heap, 0, 0x100000 );
+    ok( large != NULL, "RtlAllocateHeap failed\n" );
+
+    status = RtlQueryHeapInformation( heap, HeapWineStatistics, &after, sizeof(after), NULL );
+    ok( !status, "got status %#x\n", status );
+    ok( after.AllocCount[1] == before.AllocCount[1] + ARRAY_SIZE(ptrs), "got %s allocations of 32 bytes\n",
+        wine_dbgstr_longlong( after.AllocCount[1] - before.AllocCount[1] ));
+    ok( total_alloc_count( &after ) == total_alloc_count( &before ) + ARRAY_SIZE(ptrs) + 1,
+        "got %s allocations\n", wine_dbgstr_longlong( total_alloc_count( &after ) - total_alloc_count( &before ) ));
+    ok( after.LargeAllocCount == before.LargeAllocCount + 1, "got %s large allocations\n",
+        wine_dbgstr_longlong( after.LargeAllocCount - before.LargeAllocCount ));
+    ok( after.LargeBlockCount == before.LargeBlockCount + 1, "got %s large blocks\n",
+        wine_dbgstr_longlong( after.LargeBlockCount ));
+    ok( after.FreeCount == before.FreeCount, "got %s frees\n",
+        wine_dbgstr_longlong( after.FreeCount - before.FreeCount ));
+
+    before = after;
+    for (i = 0; i < ARRAY_SIZE(ptrs); i++) RtlFreeHeap( heap, 0, ptrs[i] );
+    RtlFreeHeap( heap, 0, large );
+
+    status = RtlQueryHeapInformation( heap, HeapWineStatistics, &after, sizeof(after), NULL );
+    ok( !status, "got status %#x\n", status );
+    ok( after.FreeCount == before.FreeCount + ARRAY_SIZE(ptrs) + 1, "got %s frees\n",
+        wine_dbgstr_longlong( after.FreeCount - before.FreeCount ));
+    ok( after.LargeBlockCount == before.LargeBlockCount - 1, "got %s large blocks\n",
+        wine_dbgstr_longlong( after.LargeBlockCount ));
+    ok( total_alloc_count( &after ) == total_alloc_count( &before ), "got %s allocations\n",
+        wine_dbgstr_longlong( total_alloc_count( &after ) - total_alloc_count( &before ) ));
+
+    RtlDestroyHeap( heap );
+}
+
+START_TEST(heap)
+{
+    test_wine_statistics();
+}
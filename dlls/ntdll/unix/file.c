@@ -58,6 +58,9 @@
 #ifdef HAVE_SYS_TIME_H
 # include <sys/time.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+# include <sys/uio.h>
+#endif
 #ifdef HAVE_SYS_ATTR_H
 #include <sys/attr.h>
 #endif
@@ -220,6 +223,7 @@ struct dir_data
     unsigned int            size;    /* size of the names array */
     unsigned int            count;   /* count of used entries in the names array */
     unsigned int            pos;     /* current reading position in the names array */
+    LONG                    refcount; /* references held by the lookup cache and its users */
     struct file_identity    id;      /* directory file identity */
     struct dir_data_names  *names;   /* directory file names */
     struct dir_data_buffer *buffer;  /* head of data buffers list */
@@ -232,6 +236,21 @@ static const unsigned int dir_data_names_initial_size  = 64;
 static struct dir_data **dir_data_cache;
 static unsigned int dir_data_cache_size;
 
+/* cache of directory contents for case-insensitive lookups, validated against the directory times */
+struct dir_lookup
+{
+    struct file_identity    id;      /* directory file identity */
+    LARGE_INTEGER           mtime;   /* directory modification time when the names were read */
+    LARGE_INTEGER           ctime;   /* directory change time when the names were read */
+    struct dir_data        *data;    /* directory file names */
+};
+
+#define DIR_LOOKUP_CACHE_SIZE 16
+#define DIR_LOOKUP_MAX_ENTRIES 4096  /* larger directories are searched without caching them */
+
+static struct dir_lookup dir_lookup_cache[DIR_LOOKUP_CACHE_SIZE];
+static unsigned int dir_lookup_next;
+
 static BOOL show_dot_files;
 static mode_t start_umask;
 
@@ -239,6 +258,7 @@ static mode_t start_umask;
 static const BOOL is_case_sensitive = FALSE;
 
 static pthread_mutex_t dir_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t dir_lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
 static pthread_mutex_t mnt_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /* check if a given Unicode char is OK in a DOS short name */
@@ -1521,6 +1541,35 @@ static int get_file_info( const char *path, struct stat *st, ULONG *attr )
 }
 
 
+/* get the stat info and file attributes for an entry of the current directory */
+static int get_dir_entry_info( const char *name, const struct file_identity *dir,
+                               struct stat *st, ULONG *attr )
+{
+    int ret;
+
+    /* the parent of "." and ".." is not the current directory */
+    if (name[0] == '.' && (!name[1] || (name[1] == '.' && !name[2])))
+        return get_file_info( name, st, attr );
+
+    *attr = 0;
+    ret = lstat( name, st );
+    if (ret == -1) return ret;
+    if (S_ISLNK( st->st_mode ))
+    {
+        ret = stat( name, st );
+        if (ret == -1) return ret;
+        /* is a symbolic link and a directory, consider these "reparse points" */
+        if (S_ISDIR( st->st_mode )) *attr |= FILE_ATTRIBUTE_REPARSE_POINT;
+    }
+    /* consider mount points to be reparse points (IO_REPARSE_TAG_MOUNT_POINT);
+     * the parent of a subdirectory is the directory itself, so there's no need to stat it */
+    else if (S_ISDIR( st->st_mode ) && (st->st_dev != dir->dev || st->st_ino == dir->ino))
+        *attr |= FILE_ATTRIBUTE_REPARSE_POINT;
+    *attr |= get_file_attributes( st );
+    return ret;
+}
+
+
 #if defined(__ANDROID__) && !defined(HAVE_FUTIMENS)
 static int futimens( int fd, const struct timespec spec[2] )
 {
@@ -2015,7 +2064,7 @@ static NTSTATUS get_dir_data_entry( struct dir_data *dir_data, void *info_ptr, I
     struct stat st;
     ULONG name_len, start, dir_size, attributes;
 
-    if (get_file_info( names->unix_name, &st, &attributes ) == -1)
+    if (get_dir_entry_info( names->unix_name, &dir_data->id, &st, &attributes ) == -1)
     {
         TRACE( "file no longer exists %s\n", names->unix_name );
         return STATUS_SUCCESS;
@@ -2485,6 +2534,122 @@ NTSTATUS WINAPI NtQueryDirectoryFile( HANDLE handle, HANDLE event, PIO_APC_ROUTI
 }
 
 
+/***********************************************************************
+ *           read_dir_lookup_data
+ *
+ * Read all the names of a directory for case-insensitive lookups.
+ * Fails with STATUS_BUFFER_OVERFLOW if the directory is too large to be cached.
+ */
+static NTSTATUS read_dir_lookup_data( struct dir_data **data_ret, const char *unix_name )
+{
+    struct dir_data *data;
+    struct dirent *de;
+    NTSTATUS status = STATUS_SUCCESS;
+    DIR *dir;
+
+    if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
+    if (!(data = calloc( 1, sizeof(*data) )))
+    {
+        closedir( dir );
+        return STATUS_NO_MEMORY;
+    }
+    while ((de = readdir( dir )))
+    {
+        if (data->count == DIR_LOOKUP_MAX_ENTRIES)
+        {
+            status = STATUS_BUFFER_OVERFLOW;
+            break;
+        }
+        if (!append_entry( data, de->d_name, NULL, NULL ))
+        {
+            status = STATUS_NO_MEMORY;
+            break;
+        }
+    }
+    closedir( dir );
+    if (status)
+    {
+        free_dir_data( data );
+        return status;
+    }
+    data->refcount = 1;
+    *data_ret = data;
+    return STATUS_SUCCESS;
+}
+
+
+/***********************************************************************
+ *           release_dir_lookup_data
+ */
+static void release_dir_lookup_data( struct dir_data *data )
+{
+    if (data && !InterlockedDecrement( &data->refcount )) free_dir_data( data );
+}
+
+
+/***********************************************************************
+ *           get_dir_lookup_data
+ *
+ * Retrieve the names of a directory from the lookup cache, reading them if necessary.
+ * The returned data must be released by the caller with release_dir_lookup_data().
+ * Directories modified recently or too large to be cached are not read, and
+ * STATUS_NOT_FOUND is returned so that the caller can scan them directly.
+ */
+static NTSTATUS get_dir_lookup_data( struct dir_data **data_ret, const char *unix_name )
+{
+    LARGE_INTEGER mtime, ctime, atime, creation;
+    struct dir_lookup *entry;
+    struct dir_data *old_data;
+    struct stat st;
+    NTSTATUS status;
+    unsigned int i;
+
+    if (stat( unix_name, &st ) == -1) return errno_to_status( errno );
+    get_file_times( &st, &mtime, &ctime, &atime, &creation );
+
+    mutex_lock( &dir_lookup_mutex );
+    for (i = 0; i < DIR_LOOKUP_CACHE_SIZE; i++)
+    {
+        entry = &dir_lookup_cache[i];
+        if (!entry->data || !is_same_file( &entry->id, &st )) continue;
+        if (entry->mtime.QuadPart != mtime.QuadPart || entry->ctime.QuadPart != ctime.QuadPart) break;
+        *data_ret = entry->data;
+        InterlockedIncrement( &entry->data->refcount );
+        mutex_unlock( &dir_lookup_mutex );
+        return STATUS_SUCCESS;
+    }
+    mutex_unlock( &dir_lookup_mutex );
+
+    /* the times may not have enough resolution to catch a change made right after
+     * reading the directory, so don't cache directories that were modified recently */
+    if (st.st_mtime >= time( NULL ) - 1 || st.st_ctime >= time( NULL ) - 1) return STATUS_NOT_FOUND;
+
+    if ((status = read_dir_lookup_data( data_ret, unix_name )))
+        return status == STATUS_BUFFER_OVERFLOW ? STATUS_NOT_FOUND : status;
+
+    mutex_lock( &dir_lookup_mutex );
+    for (i = 0; i < DIR_LOOKUP_CACHE_SIZE; i++)
+        if (dir_lookup_cache[i].data && is_same_file( &dir_lookup_cache[i].id, &st )) break;
+    if (i == DIR_LOOKUP_CACHE_SIZE)
+    {
+        i = dir_lookup_next;
+        dir_lookup_next = (dir_lookup_next + 1) % DIR_LOOKUP_CACHE_SIZE;
+    }
+    entry = &dir_lookup_cache[i];
+    old_data = entry->data;
+    entry->id.dev = st.st_dev;
+    entry->id.ino = st.st_ino;
+    entry->mtime = mtime;
+    entry->ctime = ctime;
+    entry->data = *data_ret;
+    InterlockedIncrement( &entry->data->refcount );
+    mutex_unlock( &dir_lookup_mutex );
+
+    release_dir_lookup_data( old_data );
+    return STATUS_SUCCESS;
+}
+
+
 /***********************************************************************
  *           find_file_in_dir
  *
@@ -2496,10 +2661,14 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
                                   BOOLEAN check_case )
 {
     WCHAR buffer[MAX_DIR_ENTRY_LEN];
+    struct dir_data *data = NULL;
     BOOLEAN is_name_8_dot_3;
+    BOOL found = FALSE;
+    struct stat st;
+    unsigned int i;
+    NTSTATUS status;
     DIR *dir;
     struct dirent *de;
-    struct stat st;
     int ret;
 
     /* try a shortcut for this directory */
@@ -2534,6 +2703,7 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
         if (fd != -1)
         {
             KERNEL_DIRENT kde[2];
+            WCHAR buffer[MAX_DIR_ENTRY_LEN];
 
             if (ioctl( fd, VFAT_IOCTL_READDIR_BOTH, (long)kde ) != -1)
             {
@@ -2575,6 +2745,30 @@ static NTSTATUS find_file_in_dir( char *unix_name, int pos, const WCHAR *name, i
     }
 #endif /* VFAT_IOCTL_READDIR_BOTH */
 
+    status = get_dir_lookup_data( &data, unix_name );
+    if (status == STATUS_SUCCESS)
+    {
+        unix_name[pos - 1] = '/';
+        for (i = 0; i < data->count; i++)
+        {
+            const struct dir_data_names *names = &data->names[i];
+
+            if ((!wcsnicmp( names->long_name, name, length ) && !names->long_name[length]) ||
+                (is_name_8_dot_3 && !wcsnicmp( names->short_name, name, length ) && !names->short_name[length]))
+            {
+                strcpy( unix_name + pos, names->unix_name );
+                found = TRUE;
+                break;
+            }
+        }
+        release_dir_lookup_data( data );
+        if (found) return STATUS_SUCCESS;
+        goto not_found;
+    }
+    if (status != STATUS_NOT_FOUND) return status;
+
+    /* the directory can't be cached, scan it directly */
+
     if (!(dir = opendir( unix_name ))) return errno_to_status( errno );
 
     unix_name[pos - 1] = '/';
@@ -5316,6 +5510,22 @@ err:
 }
 
 
+/* fill an iovec array with the remaining page-sized segments of a scatter/gather request */
+static unsigned int get_segments_iovec( struct iovec *iov, unsigned int max_count,
+                                        const FILE_SEGMENT_ELEMENT *segments, ULONG pos, ULONG length )
+{
+    unsigned int count;
+
+    for (count = 0; count < max_count && length; count++, pos = 0)
+    {
+        iov[count].iov_base = (char *)segments[count].Buffer + pos;
+        iov[count].iov_len = min( length, page_size - pos );
+        length -= iov[count].iov_len;
+    }
+    return count;
+}
+
+
 /******************************************************************************
  *              NtReadFileScatter   (NTDLL.@)
  */
@@ -5350,11 +5560,17 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
 
     while (length)
     {
+        struct iovec iov[64];
+        unsigned int count = get_segments_iovec( iov, ARRAY_SIZE(iov), segments, pos, length );
+
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
-            result = pread( unix_handle, (char *)segments->Buffer + pos,
-                            min( length - pos, page_size - pos ), offset->QuadPart + total );
+#ifdef HAVE_PREADV
+            result = preadv( unix_handle, iov, count, offset->QuadPart + total );
+#else
+            result = pread( unix_handle, iov[0].iov_base, iov[0].iov_len, offset->QuadPart + total );
+#endif
         else
-            result = read( unix_handle, (char *)segments->Buffer + pos, min( length - pos, page_size - pos ) );
+            result = readv( unix_handle, iov, count );
 
         if (result == -1)
         {
@@ -5365,11 +5581,9 @@ NTSTATUS WINAPI NtReadFileScatter( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         if (!result) break;
         total += result;
         length -= result;
-        if ((pos += result) == page_size)
-        {
-            pos = 0;
-            segments++;
-        }
+        pos += result;
+        segments += pos / page_size;
+        pos %= page_size;
     }
 
     if (total == 0) status = STATUS_END_OF_FILE;
@@ -5653,11 +5867,17 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
 
     while (length)
     {
+        struct iovec iov[64];
+        unsigned int count = get_segments_iovec( iov, ARRAY_SIZE(iov), segments, pos, length );
+
         if (offset && offset->QuadPart != FILE_USE_FILE_POINTER_POSITION)
-            result = pwrite( unix_handle, (char *)segments->Buffer + pos,
-                             page_size - pos, offset->QuadPart + total );
+#ifdef HAVE_PWRITEV
+            result = pwritev( unix_handle, iov, count, offset->QuadPart + total );
+#else
+            result = pwrite( unix_handle, iov[0].iov_base, iov[0].iov_len, offset->QuadPart + total );
+#endif
         else
-            result = write( unix_handle, (char *)segments->Buffer + pos, page_size - pos );
+            result = writev( unix_handle, iov, count );
 
         if (result == -1)
         {
@@ -5677,11 +5897,9 @@ NTSTATUS WINAPI NtWriteFileGather( HANDLE file, HANDLE event, PIO_APC_ROUTINE ap
         }
         total += result;
         length -= result;
-        if ((pos += result) == page_size)
-        {
-            pos = 0;
-            segments++;
-        }
+        pos += result;
+        segments += pos / page_size;
+        pos %= page_size;
     }
 
     send_completion = cvalue != 0;
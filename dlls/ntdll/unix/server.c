@@ -257,9 +257,42 @@ static void read_reply_data( void *buffer, size_t size )
  */
 static inline unsigned int wait_reply( struct __server_request_info *req )
 {
-    read_reply_data( &req->u.reply, sizeof(req->u.reply) );
-    if (req->u.reply.reply_header.reply_size)
-        read_reply_data( req->reply_data, req->u.reply.reply_header.reply_size );
+    data_size_t max_size = req->u.req.request_header.reply_size;
+    struct iovec vec[2];
+    size_t size;
+    int ret;
+
+    if (!max_size)
+    {
+        read_reply_data( &req->u.reply, sizeof(req->u.reply) );
+        return req->u.reply.reply_header.error;
+    }
+
+    /* only one reply can be pending on the pipe, so we can read the header
+     * and the variable data at once, saving a syscall for most requests */
+    vec[0].iov_base = &req->u.reply;
+    vec[0].iov_len  = sizeof(req->u.reply);
+    vec[1].iov_base = req->reply_data;
+    vec[1].iov_len  = max_size;
+    for (;;)
+    {
+        if ((ret = readv( ntdll_get_thread_data()->reply_fd, vec, 2 )) > 0) break;
+        if (!ret) abort_thread(0);  /* the server closed the connection; time to die... */
+        if (errno == EINTR) continue;
+        if (errno == EPIPE) abort_thread(0);
+        server_protocol_perror("read");
+    }
+    if (ret < sizeof(req->u.reply))
+    {
+        read_reply_data( (char *)&req->u.reply + ret, sizeof(req->u.reply) - ret );
+        ret = sizeof(req->u.reply);
+    }
+    size = ret - sizeof(req->u.reply);
+    if (size > req->u.reply.reply_header.reply_size)
+        server_protocol_error( "reply data overflow %u/%u\n",
+                               (unsigned int)size, req->u.reply.reply_header.reply_size );
+    if (size < req->u.reply.reply_header.reply_size)
+        read_reply_data( (char *)req->reply_data + size, req->u.reply.reply_header.reply_size - size );
     return req->u.reply.reply_header.error;
 }
 
@@ -2214,6 +2214,32 @@ typedef struct _RTL_HEAP_DEFINITION {
     ULONG Unknown[11];
 } RTL_HEAP_DEFINITION, *PRTL_HEAP_DEFINITION;
 
+#ifdef __WINESRC__
+#define HEAP_STATS_NB_CLASSES 16
+
+/* returned by RtlQueryHeapInformation( HeapWineStatistics ) */
+typedef struct _HEAP_WINE_STATISTICS
+{
+    ULONGLONG AllocCount[HEAP_STATS_NB_CLASSES]; /* blocks allocated from the backend by size, 16 bytes and up in powers of 2 */
+    ULONGLONG FreeCount;            /* blocks returned to the backend */
+    ULONGLONG ReAllocCount;         /* reallocations */
+    ULONGLONG SearchCount;          /* free list searches */
+    ULONGLONG SearchSteps;          /* free list entries examined during searches */
+    ULONGLONG SubheapCount;         /* sub-heaps created */
+    ULONGLONG CommitCount;          /* sub-heap commit operations */
+    ULONGLONG CommitSize;           /* total bytes committed */
+    ULONGLONG DecommitCount;        /* sub-heap decommit operations */
+    ULONGLONG DecommitSize;         /* total bytes decommitted */
+    ULONGLONG LargeAllocCount;      /* large blocks allocated */
+    ULONGLONG LargeBlockCount;      /* large blocks currently allocated */
+    ULONGLONG LargeBlockSize;       /* size of the large blocks currently allocated */
+    ULONGLONG FrontEndRefillCount;  /* low-fragmentation front end buckets refilled */
+    ULONGLONG FrontEndTrimCount;    /* low-fragmentation front end buckets trimmed */
+    ULONGLONG ContentionCount;      /* lock acquisitions that had to wait */
+    ULONGLONG ContentionTime;       /* time spent waiting for the lock, in performance counter ticks */
+} HEAP_WINE_STATISTICS;
+#endif
+
 typedef struct _RTL_RWLOCK {
     RTL_CRITICAL_SECTION rtlCS;
 
@@ -371,14 +371,23 @@ static file_pos_t max_unix_offset = OFF_T_MAX;
 
 struct timeout_user
 {
-    struct list           entry;      /* entry in sorted timeout list */
+    struct list           entry;      /* entry in expired list, once removed from the heap */
+    int                   index;      /* index in timeout heap, -1 once expired */
     abstime_t             when;       /* timeout expiry */
     timeout_callback      callback;   /* callback function */
     void                 *private;    /* callback private data */
 };
 
-static struct list abs_timeout_list = LIST_INIT(abs_timeout_list); /* sorted absolute timeouts list */
-static struct list rel_timeout_list = LIST_INIT(rel_timeout_list); /* sorted relative timeouts list */
+/* binary min-heap of timeouts, ordered by expiry */
+struct timeout_heap
+{
+    struct timeout_user **users;      /* heap array */
+    int                   count;      /* number of timeouts in the heap */
+    int                   size;       /* allocated size of the array */
+};
+
+static struct timeout_heap abs_timeouts;  /* absolute timeouts heap */
+static struct timeout_heap rel_timeouts;  /* relative (monotonic) timeouts heap */
 timeout_t current_time;
 timeout_t monotonic_time;
 
@@ -455,43 +464,108 @@ void set_current_time(void)
     if (user_shared_data) set_user_shared_data_time();
 }
 
+/* get the expiry time of a timeout in its own time base */
+static inline timeout_t get_timeout_expiry( const struct timeout_user *user )
+{
+    return user->when > 0 ? user->when : -user->when;
+}
+
+static inline struct timeout_heap *get_timeout_heap( const struct timeout_user *user )
+{
+    return user->when > 0 ? &abs_timeouts : &rel_timeouts;
+}
+
+static void set_heap_timeout( struct timeout_heap *heap, int index, struct timeout_user *user )
+{
+    heap->users[index] = user;
+    user->index = index;
+}
+
+/* move a timeout up the heap until its parent expires before it */
+static void timeout_heap_up( struct timeout_heap *heap, int index )
+{
+    struct timeout_user *user = heap->users[index];
+
+    while (index)
+    {
+        int parent = (index - 1) / 2;
+        if (get_timeout_expiry( heap->users[parent] ) <= get_timeout_expiry( user )) break;
+        set_heap_timeout( heap, index, heap->users[parent] );
+        index = parent;
+    }
+    set_heap_timeout( heap, index, user );
+}
+
+/* move a timeout down the heap until its children expire after it */
+static void timeout_heap_down( struct timeout_heap *heap, int index )
+{
+    struct timeout_user *user = heap->users[index];
+
+    for (;;)
+    {
+        int child = 2 * index + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count &&
+            get_timeout_expiry( heap->users[child + 1] ) < get_timeout_expiry( heap->users[child] ))
+            child++;
+        if (get_timeout_expiry( user ) <= get_timeout_expiry( heap->users[child] )) break;
+        set_heap_timeout( heap, index, heap->users[child] );
+        index = child;
+    }
+    set_heap_timeout( heap, index, user );
+}
+
+/* remove a timeout from its heap */
+static void timeout_heap_remove( struct timeout_heap *heap, struct timeout_user *user )
+{
+    struct timeout_user *last = heap->users[--heap->count];
+    int index = user->index;
+
+    user->index = -1;
+    if (last == user) return;
+    set_heap_timeout( heap, index, last );
+    timeout_heap_up( heap, index );
+    timeout_heap_down( heap, last->index );
+}
+
 /* add a timeout user */
 struct timeout_user *add_timeout_user( timeout_t when, timeout_callback func, void *private )
 {
     struct timeout_user *user;
-    struct list *ptr;
+    struct timeout_heap *heap;
 
     if (!(user = mem_alloc( sizeof(*user) ))) return NULL;
     user->when     = timeout_to_abstime( when );
     user->callback = func;
     user->private  = private;
 
-    /* Now insert it in the linked list */
+    /* Now insert it in the heap */
 
-    if (user->when > 0)
+    heap = get_timeout_heap( user );
+    if (heap->count == heap->size)
     {
-        LIST_FOR_EACH( ptr, &abs_timeout_list )
-        {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when >= user->when) break;
-        }
-    }
-    else
-    {
-        LIST_FOR_EACH( ptr, &rel_timeout_list )
+        int new_size = heap->size ? heap->size * 2 : 64;
+        struct timeout_user **new_users = realloc( heap->users, new_size * sizeof(*new_users) );
+
+        if (!new_users)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
-            if (timeout->when <= user->when) break;
+            set_error( STATUS_NO_MEMORY );
+            free( user );
+            return NULL;
         }
+        heap->users = new_users;
+        heap->size  = new_size;
     }
-    list_add_before( ptr, &user->entry );
+    heap->users[heap->count] = user;
+    timeout_heap_up( heap, heap->count++ );
     return user;
 }
 
 /* remove a timeout user */
 void remove_timeout_user( struct timeout_user *user )
 {
-    list_remove( &user->entry );
+    if (user->index == -1) list_remove( &user->entry );  /* already expired */
+    else timeout_heap_remove( get_timeout_heap( user ), user );
     free( user );
 }
 
@@ -926,31 +1000,31 @@ static int get_next_timeout(void)
 {
     int ret = user_shared_data ? user_shared_data_timeout : -1;
 
-    if (!list_empty( &abs_timeout_list ) || !list_empty( &rel_timeout_list ))
+    if (abs_timeouts.count || rel_timeouts.count)
     {
         struct list expired_list, *ptr;
 
-        /* first remove all expired timers from the list */
+        /* first remove all expired timers from the heaps */
 
         list_init( &expired_list );
-        while ((ptr = list_head( &abs_timeout_list )) != NULL)
+        while (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = abs_timeouts.users[0];
 
             if (timeout->when <= current_time)
             {
-                list_remove( &timeout->entry );
+                timeout_heap_remove( &abs_timeouts, timeout );
                 list_add_tail( &expired_list, &timeout->entry );
             }
             else break;
         }
-        while ((ptr = list_head( &rel_timeout_list )) != NULL)
+        while (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = rel_timeouts.users[0];
 
             if (-timeout->when <= monotonic_time)
             {
-                list_remove( &timeout->entry );
+                timeout_heap_remove( &rel_timeouts, timeout );
                 list_add_tail( &expired_list, &timeout->entry );
             }
             else break;
@@ -966,18 +1040,18 @@ static int get_next_timeout(void)
             free( timeout );
         }
 
-        if ((ptr = list_head( &abs_timeout_list )) != NULL)
+        if (abs_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = abs_timeouts.users[0];
             timeout_t diff = (timeout->when - current_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
             if (ret == -1 || diff < ret) ret = diff;
         }
 
-        if ((ptr = list_head( &rel_timeout_list )) != NULL)
+        if (rel_timeouts.count)
         {
-            struct timeout_user *timeout = LIST_ENTRY( ptr, struct timeout_user, entry );
+            struct timeout_user *timeout = rel_timeouts.users[0];
             timeout_t diff = (-timeout->when - monotonic_time + 9999) / 10000;
             if (diff > INT_MAX) diff = INT_MAX;
             else if (diff < 0) diff = 0;
@@ -118,6 +118,7 @@ struct key_value
 
 #define MAX_NAME_LEN  256    /* max. length of a key name */
 #define MAX_VALUE_LEN 16383  /* max. length of a value name */
+#define FILE_BUFFER_SIZE 65536  /* stdio buffer size for registry files */
 
 /* the root of the registry tree */
 static struct key *root_key;
@@ -223,7 +224,9 @@ static void dump_path( const struct key *key, const struct key *base, FILE *f )
 /* dump a value to a text file */
 static void dump_value( const struct key_value *value, FILE *f )
 {
-    unsigned int i, dw;
+    static const char hex[16] = "0123456789abcdef";
+    char buffer[256];
+    unsigned int i, dw, pos = 0;
     int count;
 
     if (value->namelen)
@@ -260,18 +263,29 @@ static void dump_value( const struct key_value *value, FILE *f )
     else count += fprintf( f, "hex(%x):", value->type );
     for (i = 0; i < value->len; i++)
     {
-        count += fprintf( f, "%02x", *((unsigned char *)value->data + i) );
+        unsigned char ch = *((unsigned char *)value->data + i);
+
+        if (pos > sizeof(buffer) - 8)
+        {
+            fwrite( buffer, pos, 1, f );
+            pos = 0;
+        }
+        buffer[pos++] = hex[ch >> 4];
+        buffer[pos++] = hex[ch & 0x0f];
+        count += 2;
         if (i < value->len-1)
         {
-            fputc( ',', f );
+            buffer[pos++] = ',';
             if (++count > 76)
             {
-                fprintf( f, "\\\n  " );
+                memcpy( buffer + pos, "\\\n  ", 4 );
+                pos += 4;
                 count = 2;
             }
         }
     }
-    fputc( '\n', f );
+    buffer[pos++] = '\n';
+    fwrite( buffer, pos, 1, f );
 }
 
 /* save a registry and all its subkeys to a text file */
@@ -621,7 +635,6 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
                                  int index, timeout_t modif )
 {
     struct key *key;
-    int i;
 
     if (name->len > MAX_NAME_LEN * sizeof(WCHAR))
     {
@@ -636,8 +649,8 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
     if ((key = alloc_key( name, modif )) != NULL)
     {
         key->parent = parent;
-        for (i = ++parent->last_subkey; i > index; i--)
-            parent->subkeys[i] = parent->subkeys[i-1];
+        memmove( parent->subkeys + index + 1, parent->subkeys + index,
+                 (++parent->last_subkey - index) * sizeof(*parent->subkeys) );
         parent->subkeys[index] = key;
         if (is_wow6432node( key->name, key->namelen ) && !is_wow6432node( parent->name, parent->namelen ))
             parent->flags |= KEY_WOW64;
@@ -649,13 +662,14 @@ static struct key *alloc_subkey( struct key *parent, const struct unicode_str *n
 static void free_subkey( struct key *parent, int index )
 {
     struct key *key;
-    int i, nb_subkeys;
+    int nb_subkeys;
 
     assert( index >= 0 );
     assert( index <= parent->last_subkey );
 
     key = parent->subkeys[index];
-    for (i = index; i < parent->last_subkey; i++) parent->subkeys[i] = parent->subkeys[i + 1];
+    memmove( parent->subkeys + index, parent->subkeys + index + 1,
+             (parent->last_subkey - index) * sizeof(*parent->subkeys) );
     parent->last_subkey--;
     key->flags |= KEY_DELETED;
     key->parent = NULL;
@@ -1693,6 +1707,8 @@ static void load_keys( struct key *key, const char *filename, FILE *f, int prefi
     timeout_t modif = current_time;
     char *p;
 
+    setvbuf( f, NULL, _IOFBF, FILE_BUFFER_SIZE );
+
     info.filename = filename;
     info.file   = f;
     info.len    = 4;
@@ -1973,6 +1989,7 @@ void init_registry(void)
 /* save a registry branch to a file */
 static void save_all_subkeys( struct key *key, FILE *f )
 {
+    setvbuf( f, NULL, _IOFBF, FILE_BUFFER_SIZE );
     fprintf( f, "WINE REGISTRY Version 2\n" );
     fprintf( f, ";; All keys relative to " );
     dump_path( key, NULL, f );
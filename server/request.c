@@ -75,6 +75,8 @@
 #define SCM_RIGHTS 1
 #endif
 
+#define REQUEST_BUFFER_SIZE 1024  /* size of the per-thread request data buffer */
+
 /* path names for server master Unix socket */
 static const char * const server_socket_name = "socket";   /* name of the socket file */
 static const char * const server_lock_name = "lock";       /* name of the server lock file */
@@ -331,30 +333,68 @@ static void call_req_handler( struct thread *thread )
     current = NULL;
 }
 
+/* handle a fully read request and release the data buffer if it was grown for it */
+static void handle_request( struct thread *thread )
+{
+    call_req_handler( thread );
+    if (thread->req.request_header.request_size > REQUEST_BUFFER_SIZE)
+    {
+        free( thread->req_data );
+        thread->req_data = NULL;
+    }
+}
+
 /* read a request from a thread */
 void read_request( struct thread *thread )
 {
+    data_size_t size;
     int ret;
 
     if (!thread->req_toread)  /* no pending request */
     {
-        if ((ret = read( get_unix_fd( thread->request_fd ), &thread->req,
-                         sizeof(thread->req) )) != sizeof(thread->req)) goto error;
-        if (!(thread->req_toread = thread->req.request_header.request_size))
+        struct iovec vec[2];
+
+        /* the client waits for the reply before sending another request, so
+         * we can read the header together with the start of the data */
+        if (!thread->req_data && !(thread->req_data = malloc( REQUEST_BUFFER_SIZE )))
         {
-            /* no data, handle request at once */
-            call_req_handler( thread );
+            fatal_protocol_error( thread, "no memory for request buffer\n" );
             return;
         }
-        if (!(thread->req_data = malloc( thread->req_toread )))
+        vec[0].iov_base = &thread->req;
+        vec[0].iov_len  = sizeof(thread->req);
+        vec[1].iov_base = thread->req_data;
+        vec[1].iov_len  = REQUEST_BUFFER_SIZE;
+        if ((ret = readv( get_unix_fd( thread->request_fd ), vec, 2 )) < (int)sizeof(thread->req)) goto error;
+
+        size = thread->req.request_header.request_size;
+        ret -= sizeof(thread->req);
+        if (ret > size)
         {
-            fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
-                                  thread->req_toread, thread->req.request_header.req );
+            fatal_protocol_error( thread, "request data overflow %d/%u\n", ret, size );
             return;
         }
+        if (!(thread->req_toread = size - ret))
+        {
+            /* all the data is here, handle request at once */
+            handle_request( thread );
+            return;
+        }
+        if (size > REQUEST_BUFFER_SIZE)
+        {
+            void *ptr = realloc( thread->req_data, size );
+
+            if (!ptr)
+            {
+                fatal_protocol_error( thread, "no memory for %u bytes request %d\n",
+                                      size, thread->req.request_header.req );
+                return;
+            }
+            thread->req_data = ptr;
+        }
     }
 
-    /* read the variable sized data */
+    /* read the rest of the variable sized data */
     for (;;)
     {
         ret = read( get_unix_fd( thread->request_fd ),
@@ -364,9 +404,7 @@ void read_request( struct thread *thread )
         if (ret <= 0) break;
         if (!(thread->req_toread -= ret))
         {
-            call_req_handler( thread );
-            free( thread->req_data );
-            thread->req_data = NULL;
+            handle_request( thread );
             return;
         }
     }